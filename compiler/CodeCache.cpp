@@ -0,0 +1,162 @@
+#include "compiler/CodeCache.h"
+
+#include <cstdlib>
+
+namespace RISCV::compiler {
+
+using namespace asmjit;
+
+static constexpr size_t MEGABYTE = 1 << 20;
+
+CodeCache::CodeCache() : budget_(getDefaultBudget()) {}
+
+size_t CodeCache::getDefaultBudget() {
+    const char *env = std::getenv(SIZE_ENV);
+    if (env != nullptr && *env != '\0') {
+        const long size_mb = std::strtol(env, nullptr, 10);
+        if (size_mb >= 0) {
+            return size_mb * MEGABYTE;
+        }
+    }
+    return DEFAULT_SIZE_MB * MEGABYTE;
+}
+
+CodeCache::CompiledEntry CodeCache::add(CodeHolder &code, BasicBlock::Entrypoint entrypoint, bool is_trace) {
+    std::lock_guard holder(lock_);
+    CompiledEntry entry = nullptr;
+    if (runtime_.add(&entry, &code) != kErrorOk) {
+        return nullptr;
+    }
+
+    records_.push_front(Record{entry, entrypoint, is_trace, code.codeSize(), true, false});
+    entries_.emplace(getAddress(entry), records_.begin());
+
+    auto [owner, is_new] = owners_.try_emplace(getOwnerKey(entrypoint, is_trace), records_.begin());
+    if (!is_new) {
+        owner->second->is_replaced = true;
+        owner->second = records_.begin();
+        ++replaced_count_;
+    }
+
+    const size_t size = size_.load(std::memory_order_relaxed) + code.codeSize();
+    size_.store(size, std::memory_order_relaxed);
+    if (replaced_count_ != 0 || (budget_ != 0 && size > budget_)) {
+        needs_collection_.store(true, std::memory_order_relaxed);
+    }
+    return entry;
+}
+
+const void *CodeCache::addStub(CodeHolder &code) {
+    std::lock_guard holder(lock_);
+    const void *stub = nullptr;
+    if (runtime_.add(&stub, &code) != kErrorOk) {
+        return nullptr;
+    }
+    return stub;
+}
+
+void CodeCache::unpin(CompiledEntry entry) {
+    std::lock_guard holder(lock_);
+    auto record = entries_.find(getAddress(entry));
+    ASSERT(record != entries_.end());
+    record->second->is_pinned = false;
+    // Code could be replaced while it was installed
+    if (record->second->is_replaced) {
+        needs_collection_.store(true, std::memory_order_relaxed);
+    }
+}
+
+CodeCache::CompiledEntry CodeCache::find(BasicBlock::Entrypoint entrypoint) {
+    std::lock_guard holder(lock_);
+    auto owner = owners_.find(getOwnerKey(entrypoint, false));
+    if (owner == owners_.end()) {
+        return nullptr;
+    }
+    records_.splice(records_.begin(), records_, owner->second);
+    return owner->second->entry;
+}
+
+std::optional<CodeRange> CodeCache::findCode(const void *address) {
+    std::lock_guard holder(lock_);
+    auto record = entries_.upper_bound(reinterpret_cast<uintptr_t>(address));
+    if (record == entries_.begin()) {
+        return std::nullopt;
+    }
+    --record;
+    const auto *start = reinterpret_cast<const uint8_t *>(record->first);
+    if (static_cast<const uint8_t *>(address) >= start + record->second->size) {
+        return std::nullopt;
+    }
+    return CodeRange{start, record->second->size};
+}
+
+std::vector<CodeCache::Victim> CodeCache::collect(const std::function<bool(const Record &)> &is_installed) {
+    std::lock_guard holder(lock_);
+    needs_collection_.store(false, std::memory_order_relaxed);
+
+    std::vector<Records::iterator> chosen;
+    size_t size = size_.load(std::memory_order_relaxed);
+    if (replaced_count_ != 0) {
+        for (auto record = records_.begin(); record != records_.end(); ++record) {
+            if (record->is_replaced && !record->is_pinned) {
+                chosen.push_back(record);
+                size -= record->size;
+            }
+        }
+    }
+
+    // Going down to 3/4 of budget leaves room for code compiled next, so collections are not run on every block
+    if (budget_ != 0 && size > budget_) {
+        const size_t target = budget_ / 4 * 3;
+        for (bool installed : {false, true}) {
+            for (auto record = records_.end(); record != records_.begin() && size > target;) {
+                --record;
+                if (record->is_pinned || record->is_replaced || is_installed(*record) != installed) {
+                    continue;
+                }
+                chosen.push_back(record);
+                size -= record->size;
+            }
+        }
+    }
+
+    // Evicted blocks have no code to switch to
+    for (auto record : chosen) {
+        if (!record->is_replaced) {
+            owners_.erase(getOwnerKey(record->entrypoint, record->is_trace));
+        }
+    }
+
+    std::vector<Victim> victims;
+    victims.reserve(chosen.size());
+    for (auto record : chosen) {
+        CompiledEntry replacement = nullptr;
+        if (record->is_replaced) {
+            auto owner = owners_.find(getOwnerKey(record->entrypoint, record->is_trace));
+            if (owner != owners_.end()) {
+                replacement = owner->second->entry;
+            }
+        }
+        victims.push_back(Victim{record->entry, record->entrypoint, record->is_trace, record->is_replaced, replacement});
+        forget(record);
+    }
+    return victims;
+}
+
+void CodeCache::release(const std::vector<Victim> &victims) {
+    std::lock_guard holder(lock_);
+    for (const auto &victim : victims) {
+        runtime_.release(victim.entry);
+    }
+}
+
+void CodeCache::forget(Records::iterator record) {
+    if (record->is_replaced) {
+        --replaced_count_;
+    }
+    size_.store(size_.load(std::memory_order_relaxed) - record->size, std::memory_order_relaxed);
+    entries_.erase(getAddress(record->entry));
+    records_.erase(record);
+}
+
+}  // namespace RISCV::compiler
@@ -0,0 +1,136 @@
+#ifndef INCLUDE_CODE_CACHE_H_
+#define INCLUDE_CODE_CACHE_H_
+
+#include <asmjit/asmjit.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "compiler/SideTable.h"
+
+#include "simulator/BasicBlock.h"
+#include "utils/macros.h"
+
+namespace RISCV::compiler {
+
+// Executable memory of code compiled in this run.
+// Every block and trace owns its latest code. Code replaced by the next tier or compilation, and least recently
+// installed code once the cache is over its byte budget, is released by runtime at the point where no compiled code
+// is executing. Runtime detaches the code from cached blocks before that
+class CodeCache {
+public:
+    using CompiledEntry = BasicBlock::CompiledEntry;
+
+    // Budget in megabytes, 0 disables eviction
+    static constexpr const char *SIZE_ENV = "RISCV_JIT_CODE_CACHE_MB";
+    static constexpr size_t DEFAULT_SIZE_MB = 64;
+
+    struct Record {
+        CompiledEntry entry;
+        BasicBlock::Entrypoint entrypoint;
+        bool is_trace;
+        size_t size;
+        // Compiler thread has not finished installing the code yet
+        bool is_pinned;
+        // Newer code of the same block or trace exists
+        bool is_replaced;
+    };
+
+    // Blocks holding released code switch to replacement or go back to interpreter if there is none
+    struct Victim {
+        CompiledEntry entry;
+        BasicBlock::Entrypoint entrypoint;
+        bool is_trace;
+        bool is_replaced;
+        CompiledEntry replacement;
+    };
+
+    CodeCache();
+    ~CodeCache() = default;
+    NO_COPY_SEMANTIC(CodeCache);
+    NO_MOVE_SEMANTIC(CodeCache);
+
+    ALWAYS_INLINE asmjit::Environment getEnvironment() const {
+        return runtime_.environment();
+    }
+
+    ALWAYS_INLINE asmjit::CpuFeatures getCpuFeatures() const {
+        return runtime_.cpuFeatures();
+    }
+
+    ALWAYS_INLINE size_t getSize() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE size_t getBudget() const {
+        return budget_;
+    }
+
+    // Checked by runtime before every block, so it is a single load
+    ALWAYS_INLINE bool needsCollection() const {
+        return needs_collection_.load(std::memory_order_relaxed);
+    }
+
+    // Dispatcher checks the flag by itself
+    ALWAYS_INLINE const std::atomic<bool> *getCollectionFlag() const {
+        return &needs_collection_;
+    }
+
+    // Returns nullptr if code could not be allocated. New code stays pinned until unpin
+    CompiledEntry add(asmjit::CodeHolder &code, BasicBlock::Entrypoint entrypoint, bool is_trace);
+    void unpin(CompiledEntry entry);
+    // Runtime code which is never released and is not counted against budget
+    const void *addStub(asmjit::CodeHolder &code);
+
+    // Latest code of the block, it becomes the most recently used
+    CompiledEntry find(BasicBlock::Entrypoint entrypoint);
+
+    // Code of block or trace the address belongs to
+    std::optional<CodeRange> findCode(const void *address);
+
+    // Picks replaced code and, while cache is over budget, least recently used code starting from the one no cached
+    // block holds. Victims are forgotten by the cache but stay in memory until release
+    std::vector<Victim> collect(const std::function<bool(const Record &)> &is_installed);
+    void release(const std::vector<Victim> &victims);
+
+private:
+    using Records = std::list<Record>;
+
+    static size_t getDefaultBudget();
+
+    static ALWAYS_INLINE uintptr_t getAddress(CompiledEntry entry) {
+        return reinterpret_cast<uintptr_t>(entry);
+    }
+
+    // Entrypoints are aligned to instruction size, so the lowest bit is free
+    static ALWAYS_INLINE uint64_t getOwnerKey(BasicBlock::Entrypoint entrypoint, bool is_trace) {
+        return entrypoint | static_cast<uint64_t>(is_trace);
+    }
+
+    void forget(Records::iterator record);
+
+    const size_t budget_;
+    std::atomic<size_t> size_{0};
+    std::atomic<bool> needs_collection_{false};
+
+    std::mutex lock_;
+    asmjit::JitRuntime runtime_;
+    // The most recently used code is at the front
+    Records records_;
+    // Ordered by address to find code by return address
+    std::map<uintptr_t, Records::iterator> entries_;
+    // Latest code of blocks and traces
+    std::unordered_map<uint64_t, Records::iterator> owners_;
+    size_t replaced_count_ = 0;
+};
+
+}  // namespace RISCV::compiler
+
+#endif  // INCLUDE_CODE_CACHE_H_
@@ -1,5 +1,8 @@
 #include "compiler/Codegen.h"
 
+#include <type_traits>
+
+#include "compiler/SideTable.h"
 #include "simulator/Hart.h"
 
 namespace RISCV::compiler {
@@ -7,13 +10,16 @@ namespace RISCV::compiler {
 using namespace asmjit;
 
 void CodeGenerator::initialize() {
-    static auto entry_signature = FuncSignatureT<void, Hart *, const DecodedInstruction *>();
+    code_start_ = compiler_.newLabel();
+    compiler_.bind(code_start_);
+
+    static auto entry_signature = FuncSignatureT<BasicBlock *, Hart *, BasicBlock *>();
     auto *entry_node = compiler_.addFunc(entry_signature);
 
     hart_p_ = compiler_.newGpq();
-    instr_p_ = compiler_.newGpq();
+    bb_p_ = compiler_.newGpq();
     entry_node->setArg(0, hart_p_);
-    entry_node->setArg(1, instr_p_);
+    entry_node->setArg(1, bb_p_);
 
     pc_p_ = compiler_.newGpq();
     compiler_.mov(pc_p_, hart_p_);
@@ -22,60 +28,365 @@ void CodeGenerator::initialize() {
     regs_p_ = compiler_.newGpq();
     compiler_.mov(regs_p_, hart_p_);
     compiler_.add(regs_p_, Hart::getOffsetToRegs());
+
+    // Addresses of this process are loaded from hart, so the code stays valid for the next run
+    pmem_p_ = compiler_.newGpq();
+    compiler_.mov(pmem_p_, x86::qword_ptr(hart_p_, Hart::getOffsetToRawMemory()));
+
+    helpers_p_ = compiler_.newGpq();
+    compiler_.mov(helpers_p_, x86::qword_ptr(hart_p_, Hart::getOffsetToHelpers()));
+}
+
+void CodeGenerator::generateTierUpCounter() {
+    tier_up_ = compiler_.newLabel();
+    tier_up_done_ = compiler_.newLabel();
+
+    compiler_.sub(x86::dword_ptr(bb_p_, BasicBlock::getOffsetToTierUpCounter()), 1);
+    compiler_.jz(tier_up_);
+    compiler_.bind(tier_up_done_);
 }
 
 void CodeGenerator::finalize() {
+    if (tier_up_.isValid()) {
+        // Taken once per block, tier 1 code keeps running until tier 2 one is installed
+        compiler_.bind(tier_up_);
+        auto tier_up = compiler_.newGpq();
+        compiler_.mov(tier_up, x86::qword_ptr(helpers_p_, offsetof(RuntimeHelpers, tier_up)));
+
+        static auto tier_up_signature = FuncSignatureT<void, Hart *, BasicBlock *>();
+        InvokeNode *invokeNode = nullptr;
+        compiler_.invoke(&invokeNode, tier_up, tier_up_signature);
+        invokeNode->setArg(0, hart_p_);
+        invokeNode->setArg(1, bb_p_);
+        compiler_.jmp(tier_up_done_);
+    }
+
+    for (const auto &side_exit : side_exits_) {
+        compiler_.bind(side_exit.label);
+        generateStoreRegs(side_exit.regs, side_exit.dirty_regs, side_exit.const_regs, side_exit.const_values);
+        generateSetPC(side_exit.pc);
+        generateCountInstrs(side_exit.instr_count);
+
+        auto next_bb = compiler_.newGpq();
+        compiler_.xor_(next_bb.r32(), next_bb.r32());
+        compiler_.ret(next_bb);
+    }
+
     compiler_.endFunc();
+
+    // Operands of invoked instructions are kept next to the code, it is addressed relative to RIP and stays
+    // relocatable
+    for (const auto &embedded : embedded_instrs_) {
+        compiler_.align(AlignMode::kData, alignof(DecodedInstruction));
+        compiler_.bind(embedded.label);
+        compiler_.embed(&embedded.instr, sizeof(DecodedInstruction));
+    }
+
+    static_assert(sizeof(SafePoint) == 16);
+    compiler_.align(AlignMode::kData, alignof(SafePoint));
+    for (const auto &safe_point : safe_points_) {
+        compiler_.embedLabelDelta(safe_point.begin, code_start_, sizeof(SafePoint::begin));
+        compiler_.embedLabelDelta(safe_point.end, code_start_, sizeof(SafePoint::end));
+        compiler_.embed(&safe_point.pc, sizeof(SafePoint::pc));
+    }
+    const uint64_t safe_points_count = safe_points_.size();
+    compiler_.embed(&safe_points_count, sizeof(safe_points_count));
+
     compiler_.finalize();
 }
 
+x86::Gp CodeGenerator::generateLoadReg(size_t index) {
+    ASSERT(index > 0 && index < RegisterType::REGISTER_COUNT);
+    const uint32_t mask = 1U << index;
+    if ((loaded_regs_ & mask) == 0) {
+        guest_regs_[index] = compiler_.newGpq();
+        if (const_regs_ & mask) {
+            compiler_.mov(guest_regs_[index], const_values_[index]);
+        } else {
+            compiler_.mov(guest_regs_[index], x86::qword_ptr(regs_p_, sizeof(RegValue) * index));
+        }
+        loaded_regs_ |= mask;
+    }
+    return guest_regs_[index];
+}
+
 x86::Gp CodeGenerator::generateGetReg(size_t index) {
     auto reg = compiler_.newGpq();
-    compiler_.mov(reg, x86::qword_ptr(regs_p_, sizeof(RegValue) * index));
+    if (index == 0) {
+        compiler_.xor_(reg.r32(), reg.r32());
+    } else if (isConstReg(index)) {
+        compiler_.mov(reg, getConstReg(index));
+    } else {
+        compiler_.mov(reg, generateLoadReg(index));
+    }
     return reg;
 }
 
 void CodeGenerator::generateSetReg(size_t index, uint64_t imm) {
-    if (index > 0) {
-        compiler_.mov(x86::qword_ptr(regs_p_, sizeof(RegValue) * index), imm);
+    if (index > 0 && is_optimizing_) {
+        // Value is materialized only if some instruction needs it in register
+        const uint32_t mask = 1U << index;
+        const_values_[index] = imm;
+        const_regs_ |= mask;
+        loaded_regs_ &= ~mask;
+        dirty_regs_ |= mask;
+    } else if (index > 0) {
+        auto reg = compiler_.newGpq();
+        compiler_.mov(reg, imm);
+        generateSetReg(index, reg);
     }
 }
 
 void CodeGenerator::generateSetReg(size_t index, x86::Gp reg) {
     if (index > 0) {
-        compiler_.mov(x86::qword_ptr(regs_p_, sizeof(RegValue) * index), reg);
+        const uint32_t mask = 1U << index;
+        guest_regs_[index] = reg;
+        loaded_regs_ |= mask;
+        dirty_regs_ |= mask;
+        const_regs_ &= ~mask;
     }
 }
 
-x86::Gp CodeGenerator::generateGetPC() {
-    // TODO(panferovi): pin PC and hart->regs_ to registers
-    auto pc = compiler_.newGpq();
-    compiler_.mov(pc, x86::qword_ptr(pc_p_));
-    return pc;
+void CodeGenerator::generateStoreRegs(const GuestRegs &regs, uint32_t mask, uint32_t const_regs,
+                                      const ConstRegs &const_values) {
+    for (size_t index = 1; index < RegisterType::REGISTER_COUNT; ++index) {
+        const uint32_t reg_mask = 1U << index;
+        if ((mask & reg_mask) == 0) {
+            continue;
+        }
+
+        auto dst = x86::qword_ptr(regs_p_, sizeof(RegValue) * index);
+        if ((const_regs & reg_mask) == 0) {
+            compiler_.mov(dst, regs[index]);
+            continue;
+        }
+
+        // Memory operand takes only sign extended 32-bit immediate
+        const uint64_t value = const_values[index];
+        if (static_cast<int64_t>(value) == static_cast<int32_t>(value)) {
+            compiler_.mov(dst, value);
+        } else {
+            auto tmp = compiler_.newGpq();
+            compiler_.mov(tmp, value);
+            compiler_.mov(dst, tmp);
+        }
+    }
+}
+
+void CodeGenerator::generateFlushRegs() {
+    generateStoreRegs(guest_regs_, dirty_regs_, const_regs_, const_values_);
+    dirty_regs_ = 0;
 }
 
 void CodeGenerator::generateSetPC(uint64_t imm) {
-    compiler_.mov(x86::qword_ptr(pc_p_), imm);
+    // Memory operand takes only sign extended 32-bit immediate
+    if (static_cast<int64_t>(imm) == static_cast<int32_t>(imm)) {
+        compiler_.mov(x86::qword_ptr(pc_p_), imm);
+    } else {
+        auto pc = compiler_.newGpq();
+        compiler_.mov(pc, imm);
+        compiler_.mov(x86::qword_ptr(pc_p_), pc);
+    }
+    is_pc_stored_ = true;
 }
 
 void CodeGenerator::generateSetPC(x86::Gp pc) {
     compiler_.mov(x86::qword_ptr(pc_p_), pc);
+    is_pc_stored_ = true;
+}
+
+void CodeGenerator::generateStorePC() {
+    if (!is_pc_stored_) {
+        generateSetPC(instr_pc_ + INSTRUCTION_BYTESIZE);
+    }
+}
+
+x86::Gp CodeGenerator::generateGetSlowPath(InstructionType type) {
+    auto slow_path = compiler_.newGpq();
+    compiler_.mov(slow_path, x86::qword_ptr(helpers_p_, offsetof(RuntimeHelpers, memory_slow_paths) +
+                                                            sizeof(const void *) * type));
+    return slow_path;
+}
+
+Label CodeGenerator::generateSafePointBegin() {
+    // Dirty registers stay in host registers on the fast path
+    generateStoreRegs(guest_regs_, dirty_regs_, const_regs_, const_values_);
+    auto begin = compiler_.newLabel();
+    compiler_.bind(begin);
+    return begin;
 }
 
-void CodeGenerator::generateIncrementPC() {
-    compiler_.add(x86::qword_ptr(pc_p_), INSTRUCTION_BYTESIZE);
+void CodeGenerator::generateSafePointEnd(Label begin) {
+    // Register allocator may put moves of the result after the call, so return address is not exactly here
+    auto end = compiler_.newLabel();
+    compiler_.bind(end);
+    safe_points_.push_back(SafePointLabels{begin, end, instr_pc_});
 }
 
-void CodeGenerator::generateInvoke(Executor executor, size_t instr_offest) {
-    auto instr = compiler_.newGpq();
-    compiler_.mov(instr, instr_p_);
-    compiler_.add(instr, sizeof(DecodedInstruction) * instr_offest);
+void CodeGenerator::generateInvoke(const DecodedInstruction &instr) {
+    // Executor works with hart->regs_ and hart->pc_ directly and advances PC itself
+    generateFlushRegs();
+    generateSetPC(instr_pc_);
+
+    auto executor = compiler_.newGpq();
+    compiler_.mov(executor,
+                  x86::qword_ptr(helpers_p_, offsetof(RuntimeHelpers, executors) + sizeof(Executor) * instr.type));
+
+    EmbeddedInstr embedded{compiler_.newLabel(), instr};
+    auto instr_p = compiler_.newGpq();
+    compiler_.lea(instr_p, x86::ptr(embedded.label));
+    embedded_instrs_.push_back(embedded);
 
     static auto executor_signature = FuncSignatureT<void, Hart *, const DecodedInstruction &>();
     asmjit::InvokeNode *invokeNode = nullptr;
     compiler_.invoke(&invokeNode, executor, executor_signature);
     invokeNode->setArg(0, hart_p_);
-    invokeNode->setArg(1, instr);
+    invokeNode->setArg(1, instr_p);
+
+    loaded_regs_ = 0;
+    const_regs_ = 0;
+    is_pc_stored_ = true;
+}
+
+x86::Gp CodeGenerator::generateGetLinkSlot(BasicBlock::LinkIndex link_index) {
+    auto link_slot = compiler_.newGpq();
+    compiler_.lea(link_slot, x86::ptr(bb_p_, BasicBlock::getOffsetToLinks() + sizeof(BasicBlock *) * link_index));
+    return link_slot;
+}
+
+void CodeGenerator::generateExit(x86::Gp link_slot) {
+    generateFlushRegs();
+    generateStorePC();
+
+    auto next_bb = compiler_.newGpq();
+    auto linked = compiler_.newLabel();
+
+    compiler_.mov(next_bb, x86::qword_ptr(link_slot));
+    compiler_.test(next_bb, next_bb);
+    compiler_.jnz(linked);
+
+    // Successor is unknown yet, runtime will patch the slot once it is compiled
+    compiler_.mov(x86::qword_ptr(hart_p_, Hart::getOffsetToPendingLink()), link_slot);
+
+    compiler_.bind(linked);
+    generateCountInstrs(instr_count_);
+    compiler_.ret(next_bb);
+}
+
+void CodeGenerator::generateCountInstrs(size_t count) {
+    compiler_.add(x86::qword_ptr(hart_p_, Hart::getOffsetToInstrCount()), count);
+}
+
+void CodeGenerator::generateLinkedExit(BasicBlock::LinkIndex link_index) {
+    generateExit(generateGetLinkSlot(link_index));
+}
+
+void CodeGenerator::generateIndirectExit(x86::Gp target, bool is_return) {
+    generateFlushRegs();
+    generateStorePC();
+
+    auto next_bb = compiler_.newGpq();
+    auto linked = compiler_.newLabel();
+
+    if (is_return) {
+        generatePopReturnAddress(target, next_bb, linked);
+    }
+
+    for (size_t i = 0; i < BasicBlock::INDIRECT_LINK_COUNT; ++i) {
+        const size_t link_offset = BasicBlock::getOffsetToIndirectLinks() + sizeof(BasicBlock::IndirectLink) * i;
+        auto next_link = compiler_.newLabel();
+
+        // Entry of the target stays there after its block is evicted, so the next entry is tried as well
+        compiler_.cmp(x86::qword_ptr(bb_p_, link_offset + offsetof(BasicBlock::IndirectLink, target)), target);
+        compiler_.jne(next_link);
+        compiler_.mov(next_bb, x86::qword_ptr(bb_p_, link_offset + offsetof(BasicBlock::IndirectLink, bb)));
+        compiler_.test(next_bb, next_bb);
+        compiler_.jnz(linked);
+        compiler_.bind(next_link);
+    }
+
+    // Runtime adds the target into the cache once it is compiled
+    compiler_.mov(x86::qword_ptr(hart_p_, Hart::getOffsetToPendingIndirectLink()), bb_p_);
+    compiler_.xor_(next_bb.r32(), next_bb.r32());
+
+    compiler_.bind(linked);
+    generateCountInstrs(instr_count_);
+    compiler_.ret(next_bb);
+}
+
+void CodeGenerator::generatePushReturnAddress(uint64_t return_pc, bool has_caller) {
+    static_assert(sizeof(Hart::ReturnAddress) == 16);
+
+    auto top = compiler_.newGpq();
+    compiler_.mov(top, x86::qword_ptr(hart_p_, Hart::getOffsetToReturnStackTop()));
+    compiler_.add(top, 1);
+    compiler_.and_(top, Hart::RETURN_STACK_SIZE - 1);
+    compiler_.mov(x86::qword_ptr(hart_p_, Hart::getOffsetToReturnStackTop()), top);
+
+    auto entry = compiler_.newGpq();
+    compiler_.mov(entry, top);
+    compiler_.shl(entry, 4);
+    compiler_.add(entry, hart_p_);
+
+    auto pc = compiler_.newGpq();
+    compiler_.mov(pc, return_pc);
+    compiler_.mov(x86::qword_ptr(entry, Hart::getOffsetToReturnStack() + offsetof(Hart::ReturnAddress, pc)), pc);
+    const size_t caller_offset = Hart::getOffsetToReturnStack() + offsetof(Hart::ReturnAddress, caller);
+    if (has_caller) {
+        compiler_.mov(x86::qword_ptr(entry, caller_offset), bb_p_);
+    } else {
+        compiler_.mov(x86::qword_ptr(entry, caller_offset), 0);
+    }
+}
+
+void CodeGenerator::generatePopReturnAddress(x86::Gp target, x86::Gp next_bb, Label found_label) {
+    auto top = compiler_.newGpq();
+    compiler_.mov(top, x86::qword_ptr(hart_p_, Hart::getOffsetToReturnStackTop()));
+
+    auto entry = compiler_.newGpq();
+    compiler_.mov(entry, top);
+    compiler_.shl(entry, 4);
+    compiler_.add(entry, hart_p_);
+
+    compiler_.sub(top, 1);
+    compiler_.and_(top, Hart::RETURN_STACK_SIZE - 1);
+    compiler_.mov(x86::qword_ptr(hart_p_, Hart::getOffsetToReturnStackTop()), top);
+
+    // Return to another address than the pushed one, e.g. by longjmp, goes through inline cache
+    auto not_found = compiler_.newLabel();
+    auto unlinked = compiler_.newLabel();
+    compiler_.cmp(x86::qword_ptr(entry, Hart::getOffsetToReturnStack() + offsetof(Hart::ReturnAddress, pc)), target);
+    compiler_.jne(not_found);
+
+    auto caller = compiler_.newGpq();
+    compiler_.mov(caller, x86::qword_ptr(entry, Hart::getOffsetToReturnStack() + offsetof(Hart::ReturnAddress, caller)));
+    compiler_.test(caller, caller);
+    compiler_.jz(not_found);
+
+    // Caller could be evicted and its place taken by another block, so continuation is checked by its entrypoint
+    compiler_.mov(next_bb,
+                  x86::qword_ptr(caller, BasicBlock::getOffsetToLinks() + sizeof(BasicBlock *) * BasicBlock::FALLTHROUGH_LINK));
+    compiler_.test(next_bb, next_bb);
+    compiler_.jz(unlinked);
+    compiler_.cmp(x86::qword_ptr(next_bb, BasicBlock::getOffsetToEntrypoint()), target);
+    compiler_.je(found_label);
+    compiler_.jmp(not_found);
+
+    // Runtime links the caller once continuation is compiled
+    compiler_.bind(unlinked);
+    compiler_.mov(x86::qword_ptr(hart_p_, Hart::getOffsetToPendingReturnLink()), caller);
+
+    compiler_.bind(not_found);
+}
+
+void CodeGenerator::generateUnlinkedExit() {
+    generateFlushRegs();
+    generateStorePC();
+    generateCountInstrs(instr_count_);
+
+    auto next_bb = compiler_.newGpq();
+    compiler_.xor_(next_bb.r32(), next_bb.r32());
+    compiler_.ret(next_bb);
 }
 
 void ExecutorPrint(Hart *hart, const char *str, uint64_t reg) {
@@ -90,109 +401,597 @@ void CodeGenerator::generatePrint(const char *str, x86::Gp reg) {
     invokeNode->setArg(0, hart_p_);
     invokeNode->setArg(1, str);
     invokeNode->setArg(2, reg);
+    // String address is valid only in this process
+    has_host_immediates_ = true;
 }
 
 void CodeGenerator::generateLUI(const DecodedInstruction &instr) {
     generateSetReg(instr.rd, instr.imm);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateAUIPC(const DecodedInstruction &instr) {
-    auto pc = generateGetPC();
-    compiler_.add(pc, instr.imm);
-    generateSetReg(instr.rd, pc);
-    generateIncrementPC();
+    generateSetReg(instr.rd, instr_pc_ + instr.imm);
 }
 
 void CodeGenerator::generateJAL(const DecodedInstruction &instr) {
-    auto pc = generateGetPC();
-
-    auto tmp = compiler_.newGpq();
-    compiler_.mov(tmp, pc);
-    compiler_.add(tmp, INSTRUCTION_BYTESIZE);
-    generateSetReg(instr.rd, tmp);
-
-    compiler_.add(pc, instr.imm);
-    generateSetPC(pc);
+    generateSetReg(instr.rd, instr_pc_ + INSTRUCTION_BYTESIZE);
+    generateSetPC(instr_pc_ + instr.imm);
+    if (instr.isCall()) {
+        generatePushReturnAddress(instr_pc_ + INSTRUCTION_BYTESIZE, true);
+    }
+    generateLinkedExit(BasicBlock::TAKEN_LINK);
 }
 
 void CodeGenerator::generateJALR(const DecodedInstruction &instr) {
-    auto returnPC = generateGetPC();
-    compiler_.add(returnPC, INSTRUCTION_BYTESIZE);
-
     auto nextPC = generateGetReg(instr.rs1);
     compiler_.add(nextPC, instr.imm);
     compiler_.and_(nextPC, ~1ULL);
 
-    generateSetReg(instr.rd, returnPC);
+    generateSetReg(instr.rd, instr_pc_ + INSTRUCTION_BYTESIZE);
     generateSetPC(nextPC);
+    if (instr.isCall()) {
+        generatePushReturnAddress(instr_pc_ + INSTRUCTION_BYTESIZE, true);
+    }
+
+    generateIndirectExit(nextPC, instr.isReturn());
+}
+
+void CodeGenerator::generateBranch(const DecodedInstruction &instr, BranchCondition condition) {
+    if (is_optimizing_ && isConstReg(instr.rs1) && isConstReg(instr.rs2)) {
+        const bool taken = isBranchTaken(condition, getConstReg(instr.rs1), getConstReg(instr.rs2));
+        generateSetPC(taken ? instr_pc_ + instr.imm : instr_pc_ + INSTRUCTION_BYTESIZE);
+        generateLinkedExit(taken ? BasicBlock::TAKEN_LINK : BasicBlock::FALLTHROUGH_LINK);
+        return;
+    }
+
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+
+    auto nextPC = compiler_.newGpq();
+    auto targetPC = compiler_.newGpq();
+    compiler_.mov(nextPC, instr_pc_ + INSTRUCTION_BYTESIZE);
+    compiler_.mov(targetPC, instr_pc_ + instr.imm);
+
+    auto link_slot = generateGetLinkSlot(BasicBlock::FALLTHROUGH_LINK);
+    auto taken_link_slot = generateGetLinkSlot(BasicBlock::TAKEN_LINK);
+
+    // Select taken target and exit slot without jumping: flags must not be clobbered between cmp and cmov
+    compiler_.cmp(op1, op2);
+    generateSelect(condition, nextPC, targetPC);
+    generateSelect(condition, link_slot, taken_link_slot);
+    generateSetPC(nextPC);
+
+    generateExit(link_slot);
+}
+
+void CodeGenerator::generateSelect(BranchCondition condition, x86::Gp dst, x86::Gp src) {
+    switch (condition) {
+        case BranchCondition::EQ:
+            compiler_.cmove(dst, src);
+            return;
+        case BranchCondition::NE:
+            compiler_.cmovne(dst, src);
+            return;
+        case BranchCondition::LT:
+            compiler_.cmovl(dst, src);
+            return;
+        case BranchCondition::GE:
+            compiler_.cmovge(dst, src);
+            return;
+        case BranchCondition::LTU:
+            compiler_.cmovb(dst, src);
+            return;
+        case BranchCondition::GEU:
+            compiler_.cmovae(dst, src);
+            return;
+        default:
+            UNREACHABLE();
+    }
+}
+
+void CodeGenerator::generateJump(BranchCondition condition, Label label) {
+    switch (condition) {
+        case BranchCondition::EQ:
+            compiler_.je(label);
+            return;
+        case BranchCondition::NE:
+            compiler_.jne(label);
+            return;
+        case BranchCondition::LT:
+            compiler_.jl(label);
+            return;
+        case BranchCondition::GE:
+            compiler_.jge(label);
+            return;
+        case BranchCondition::LTU:
+            compiler_.jb(label);
+            return;
+        case BranchCondition::GEU:
+            compiler_.jae(label);
+            return;
+        default:
+            UNREACHABLE();
+    }
+}
+
+CodeGenerator::BranchCondition CodeGenerator::getBranchCondition(InstructionType type) {
+    switch (type) {
+        case InstructionType::BEQ:
+            return BranchCondition::EQ;
+        case InstructionType::BNE:
+            return BranchCondition::NE;
+        case InstructionType::BLT:
+            return BranchCondition::LT;
+        case InstructionType::BGE:
+            return BranchCondition::GE;
+        case InstructionType::BLTU:
+            return BranchCondition::LTU;
+        case InstructionType::BGEU:
+            return BranchCondition::GEU;
+        default:
+            UNREACHABLE();
+    }
+}
+
+bool CodeGenerator::isBranchTaken(BranchCondition condition, uint64_t op1, uint64_t op2) {
+    switch (condition) {
+        case BranchCondition::EQ:
+            return op1 == op2;
+        case BranchCondition::NE:
+            return op1 != op2;
+        case BranchCondition::LT:
+            return static_cast<int64_t>(op1) < static_cast<int64_t>(op2);
+        case BranchCondition::GE:
+            return static_cast<int64_t>(op1) >= static_cast<int64_t>(op2);
+        case BranchCondition::LTU:
+            return op1 < op2;
+        case BranchCondition::GEU:
+            return op1 >= op2;
+        default:
+            UNREACHABLE();
+    }
+}
+
+CodeGenerator::BranchCondition CodeGenerator::invertCondition(BranchCondition condition) {
+    switch (condition) {
+        case BranchCondition::EQ:
+            return BranchCondition::NE;
+        case BranchCondition::NE:
+            return BranchCondition::EQ;
+        case BranchCondition::LT:
+            return BranchCondition::GE;
+        case BranchCondition::GE:
+            return BranchCondition::LT;
+        case BranchCondition::LTU:
+            return BranchCondition::GEU;
+        case BranchCondition::GEU:
+            return BranchCondition::LTU;
+        default:
+            UNREACHABLE();
+    }
+}
+
+void CodeGenerator::generateTraceJAL(const DecodedInstruction &instr, uint64_t pc) {
+    generateSetReg(instr.rd, pc + INSTRUCTION_BYTESIZE);
+    // Returns match calls even when the call is inlined, though continuation of the trace can not be linked
+    if (instr.isCall()) {
+        generatePushReturnAddress(pc + INSTRUCTION_BYTESIZE, false);
+    }
+}
+
+void CodeGenerator::generateTraceGuard(const DecodedInstruction &instr, uint64_t pc, uint64_t next_pc) {
+    const uint64_t targetPC = pc + instr.imm;
+    const uint64_t fallthroughPC = pc + INSTRUCTION_BYTESIZE;
+    const bool taken = next_pc == targetPC;
+    auto condition = getBranchCondition(instr.type);
+    // Operands computed inside trace from immediates always lead the recorded way
+    const bool is_static = is_optimizing_ && isConstReg(instr.rs1) && isConstReg(instr.rs2) &&
+                           isBranchTaken(condition, getConstReg(instr.rs1), getConstReg(instr.rs2)) == taken;
+    if (targetPC != fallthroughPC && !is_static) {
+        auto op1 = generateGetReg(instr.rs1);
+        auto op2 = generateGetReg(instr.rs2);
+
+        // Leave trace when branch goes the other way than it did while recording
+        SideExit side_exit{compiler_.newLabel(), guest_regs_, dirty_regs_, const_regs_, const_values_,
+                           taken ? fallthroughPC : targetPC, instr_count_};
+
+        compiler_.cmp(op1, op2);
+        generateJump(taken ? invertCondition(condition) : condition, side_exit.label);
+        side_exits_.push_back(std::move(side_exit));
+    }
+}
+
+x86::Gp CodeGenerator::generateGetIRValue(const IRBlock &ir, IRValue value) {
+    auto imm = ir.getConst(value);
+    if (imm == std::nullopt) {
+        return ir_values_[value];
+    }
+
+    auto reg = compiler_.newGpq();
+    compiler_.mov(reg, *imm);
+    return reg;
+}
+
+template <typename Operand>
+void CodeGenerator::generateIROp(IROpcode opcode, x86::Gp dst, const Operand &src) {
+    switch (opcode) {
+        case IROpcode::ADD:
+        case IROpcode::ADDW:
+            compiler_.add(dst, src);
+            return;
+        case IROpcode::SUB:
+        case IROpcode::SUBW:
+            compiler_.sub(dst, src);
+            return;
+        case IROpcode::SHL:
+        case IROpcode::SHLW:
+            compiler_.shl(dst, src);
+            return;
+        case IROpcode::SHR:
+        case IROpcode::SHRW:
+            compiler_.shr(dst, src);
+            return;
+        case IROpcode::SAR:
+        case IROpcode::SARW:
+            compiler_.sar(dst, src);
+            return;
+        case IROpcode::AND:
+            compiler_.and_(dst, src);
+            return;
+        case IROpcode::OR:
+            compiler_.or_(dst, src);
+            return;
+        case IROpcode::XOR:
+            compiler_.xor_(dst, src);
+            return;
+        case IROpcode::SLT:
+            compiler_.cmp(dst, src);
+            compiler_.setl(dst.r8());
+            compiler_.movzx(dst.r32(), dst.r8());
+            return;
+        case IROpcode::SLTU:
+            compiler_.cmp(dst, src);
+            compiler_.setb(dst.r8());
+            compiler_.movzx(dst.r32(), dst.r8());
+            return;
+        default:
+            UNREACHABLE();
+    }
+}
+
+void CodeGenerator::generateIRInstr(const IRBlock &ir, IRValue value) {
+    if (ir_values_.empty()) {
+        ir_values_.resize(ir.getInstrs().size());
+    }
+
+    const auto &instr = ir.getInstr(value);
+    switch (instr.opcode) {
+        case IROpcode::NOP:
+            return;
+        case IROpcode::CONST:
+            generateSetReg(instr.rd, instr.imm);
+            return;
+        case IROpcode::GET_REG:
+            // Values are never modified in place, so guest register needs no copy
+            ir_values_[value] = generateLoadReg(instr.reg);
+            return;
+        case IROpcode::MOVE:
+            ir_values_[value] = generateGetIRValue(ir, instr.operands[0]);
+            generateSetReg(instr.rd, ir_values_[value]);
+            return;
+        case IROpcode::GUEST:
+            UNREACHABLE();
+        default:
+            break;
+    }
+
+    auto dst = compiler_.newGpq();
+    compiler_.mov(dst, generateGetIRValue(ir, instr.operands[0]));
+
+    // Word operations work on 32-bit halves and take 5 bits of shift amount
+    const bool is_word = isWordOp(instr.opcode);
+    auto op_dst = is_word ? dst.r32() : dst;
+    const uint64_t shift_mask = is_word ? 0x1f : 0x3f;
+
+    auto src_imm = instr.operands[1] == NO_VALUE ? instr.imm : ir.getConst(instr.operands[1]);
+    if (src_imm != std::nullopt && isShiftOp(instr.opcode)) {
+        generateIROp(instr.opcode, op_dst, Imm(*src_imm & shift_mask));
+    } else if (src_imm != std::nullopt && static_cast<int64_t>(*src_imm) == static_cast<int32_t>(*src_imm)) {
+        generateIROp(instr.opcode, op_dst, Imm(static_cast<int64_t>(*src_imm)));
+    } else if (src_imm != std::nullopt) {
+        auto src = compiler_.newGpq();
+        compiler_.mov(src, *src_imm);
+        generateIROp(instr.opcode, op_dst, is_word ? src.r32() : src);
+    } else {
+        auto src = ir_values_[instr.operands[1]];
+        // Shift amount goes to cl whatever the operation width is
+        generateIROp(instr.opcode, op_dst, is_word && !isShiftOp(instr.opcode) ? src.r32() : src);
+    }
+
+    if (is_word) {
+        compiler_.movsxd(dst, dst.r32());
+    }
+    ir_values_[value] = dst;
+    generateSetReg(instr.rd, dst);
+}
+
+void CodeGenerator::generateBEQ(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::EQ);
+}
+
+void CodeGenerator::generateBNE(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::NE);
+}
+
+void CodeGenerator::generateBLT(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::LT);
+}
+
+void CodeGenerator::generateBGE(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::GE);
+}
+
+void CodeGenerator::generateBLTU(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::LTU);
+}
+
+void CodeGenerator::generateBGEU(const DecodedInstruction &instr) {
+    generateBranch(instr, BranchCondition::GEU);
+}
+
+template <memory::MemoryType type, typename T>
+x86::Gp CodeGenerator::generateTranslate(x86::Gp vaddr, Label slow_path) {
+    static_assert(type == memory::MemoryType::RMem || type == memory::MemoryType::WMem);
+    static_assert(sizeof(memory::TLB::Entry) == 16);
+
+    constexpr size_t tlbCapacity =
+        type == memory::MemoryType::RMem ? memory::TLB::rTLB_CACHE_CAPACITY : memory::TLB::wTLB_CACHE_CAPACITY;
+    const size_t tlbOffset = Hart::getOffsetToTLB() + (type == memory::MemoryType::RMem
+                                                           ? memory::TLB::getOffsetToRTLB()
+                                                           : memory::TLB::getOffsetToWTLB());
+
+    // Misaligned accesses are reported by slow path
+    if constexpr (sizeof(T) > 1) {
+        compiler_.test(vaddr, sizeof(T) - 1);
+        compiler_.jnz(slow_path);
+    }
+
+    auto vpn = compiler_.newGpq();
+    compiler_.mov(vpn, vaddr);
+    compiler_.shr(vpn, memory::ADDRESS_PAGE_NUM_SHIFT);
+
+    // Byte offset of TLB entry, entries are 16 bytes long so it can not be expressed by SIB scale
+    auto entry = compiler_.newGpq();
+    compiler_.mov(entry, vpn);
+    compiler_.and_(entry, tlbCapacity - 1);
+    compiler_.shl(entry, 4);
+
+    compiler_.cmp(x86::qword_ptr(hart_p_, entry, 0, tlbOffset + offsetof(memory::TLB::Entry, first)), vpn);
+    compiler_.jne(slow_path);
+
+    // Host address = memory base + ppn + page offset
+    auto host_addr = compiler_.newGpq();
+    compiler_.mov(host_addr, vaddr);
+    compiler_.and_(host_addr, memory::ADDRESS_PAGE_OFFSET_MASK);
+    compiler_.add(host_addr, x86::qword_ptr(hart_p_, entry, 0, tlbOffset + offsetof(memory::TLB::Entry, second)));
+    compiler_.add(host_addr, pmem_p_);
+    return host_addr;
+}
+
+template <typename T>
+void CodeGenerator::generateLoad(const DecodedInstruction &instr) {
+    auto vaddr = generateGetReg(instr.rs1);
+    compiler_.add(vaddr, instr.imm);
+
+    auto slow_path = compiler_.newLabel();
+    auto done = compiler_.newLabel();
+    auto value = compiler_.newGpq();
+
+    auto host_addr = generateTranslate<memory::MemoryType::RMem, T>(vaddr, slow_path);
+    if constexpr (std::is_same_v<T, int8_t>) {
+        compiler_.movsx(value, x86::byte_ptr(host_addr));
+    } else if constexpr (std::is_same_v<T, uint8_t>) {
+        compiler_.movzx(value.r32(), x86::byte_ptr(host_addr));
+    } else if constexpr (std::is_same_v<T, int16_t>) {
+        compiler_.movsx(value, x86::word_ptr(host_addr));
+    } else if constexpr (std::is_same_v<T, uint16_t>) {
+        compiler_.movzx(value.r32(), x86::word_ptr(host_addr));
+    } else if constexpr (std::is_same_v<T, int32_t>) {
+        compiler_.movsxd(value, x86::dword_ptr(host_addr));
+    } else if constexpr (std::is_same_v<T, uint32_t>) {
+        // 32-bit move zeroes upper half
+        compiler_.mov(value.r32(), x86::dword_ptr(host_addr));
+    } else {
+        static_assert(std::is_same_v<T, uint64_t>);
+        compiler_.mov(value, x86::qword_ptr(host_addr));
+    }
+    compiler_.jmp(done);
+
+    // Slow path may raise an exception, PC of faulting instruction is restored from side table
+    compiler_.bind(slow_path);
+    auto slow_path_fn = generateGetSlowPath(instr.type);
+    auto safe_point = generateSafePointBegin();
+    static auto load_signature = FuncSignatureT<RegValue, Hart *, memory::VirtAddr>();
+    InvokeNode *invokeNode = nullptr;
+    compiler_.invoke(&invokeNode, slow_path_fn, load_signature);
+    invokeNode->setArg(0, hart_p_);
+    invokeNode->setArg(1, vaddr);
+    invokeNode->setRet(0, value);
+    generateSafePointEnd(safe_point);
+
+    compiler_.bind(done);
+    generateSetReg(instr.rd, value);
+}
+
+template <typename T>
+void CodeGenerator::generateStore(const DecodedInstruction &instr) {
+    auto vaddr = generateGetReg(instr.rs1);
+    compiler_.add(vaddr, instr.imm);
+    auto value = generateGetReg(instr.rs2);
+
+    auto slow_path = compiler_.newLabel();
+    auto done = compiler_.newLabel();
+
+    auto host_addr = generateTranslate<memory::MemoryType::WMem, T>(vaddr, slow_path);
+    if constexpr (sizeof(T) == 1) {
+        compiler_.mov(x86::byte_ptr(host_addr), value.r8());
+    } else if constexpr (sizeof(T) == 2) {
+        compiler_.mov(x86::word_ptr(host_addr), value.r16());
+    } else if constexpr (sizeof(T) == 4) {
+        compiler_.mov(x86::dword_ptr(host_addr), value.r32());
+    } else {
+        static_assert(sizeof(T) == 8);
+        compiler_.mov(x86::qword_ptr(host_addr), value);
+    }
+    compiler_.jmp(done);
+
+    // Slow path may raise an exception, PC of faulting instruction is restored from side table
+    compiler_.bind(slow_path);
+    auto slow_path_fn = generateGetSlowPath(instr.type);
+    auto safe_point = generateSafePointBegin();
+    static auto store_signature = FuncSignatureT<void, Hart *, memory::VirtAddr, RegValue>();
+    InvokeNode *invokeNode = nullptr;
+    compiler_.invoke(&invokeNode, slow_path_fn, store_signature);
+    invokeNode->setArg(0, hart_p_);
+    invokeNode->setArg(1, vaddr);
+    invokeNode->setArg(2, value);
+    generateSafePointEnd(safe_point);
+
+    compiler_.bind(done);
+}
+
+void CodeGenerator::generateLB(const DecodedInstruction &instr) {
+    generateLoad<int8_t>(instr);
+}
+
+void CodeGenerator::generateLH(const DecodedInstruction &instr) {
+    generateLoad<int16_t>(instr);
+}
+
+void CodeGenerator::generateLW(const DecodedInstruction &instr) {
+    generateLoad<int32_t>(instr);
+}
+
+void CodeGenerator::generateLD(const DecodedInstruction &instr) {
+    generateLoad<uint64_t>(instr);
+}
+
+void CodeGenerator::generateLBU(const DecodedInstruction &instr) {
+    generateLoad<uint8_t>(instr);
+}
+
+void CodeGenerator::generateLHU(const DecodedInstruction &instr) {
+    generateLoad<uint16_t>(instr);
+}
+
+void CodeGenerator::generateLWU(const DecodedInstruction &instr) {
+    generateLoad<uint32_t>(instr);
+}
+
+void CodeGenerator::generateSB(const DecodedInstruction &instr) {
+    generateStore<uint8_t>(instr);
+}
+
+void CodeGenerator::generateSH(const DecodedInstruction &instr) {
+    generateStore<uint16_t>(instr);
+}
+
+void CodeGenerator::generateSW(const DecodedInstruction &instr) {
+    generateStore<uint32_t>(instr);
+}
+
+void CodeGenerator::generateSD(const DecodedInstruction &instr) {
+    generateStore<uint64_t>(instr);
 }
 
 void CodeGenerator::generateADDI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.add(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLLI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.shl(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLTI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     // Signed comparison and Set Less (signed)
     compiler_.cmp(op1, instr.imm);
-    compiler_.setl(op1);
+    compiler_.setl(op1.r8());
+    compiler_.movzx(op1.r32(), op1.r8());
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLTIU(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     // Unsigned comparison and Set Less (unsigned)
     compiler_.cmp(op1, instr.imm);
-    compiler_.setb(op1);
+    compiler_.setb(op1.r8());
+    compiler_.movzx(op1.r32(), op1.r8());
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateXORI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.xor_(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSRLI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.shr(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSRAI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.sar(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateORI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.or_(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateANDI(const DecodedInstruction &instr) {
     auto op1 = generateGetReg(instr.rs1);
     compiler_.and_(op1, instr.imm);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
+}
+
+// Word instructions operate on 32-bit halves of host registers, the result is sign extended to 64 bits
+
+void CodeGenerator::generateADDIW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    compiler_.add(op1.r32(), instr.imm);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSLLIW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    compiler_.shl(op1.r32(), instr.imm);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSRLIW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    compiler_.shr(op1.r32(), instr.imm);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSRAIW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    compiler_.sar(op1.r32(), instr.imm);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
 }
 
 void CodeGenerator::generateADD(const DecodedInstruction &instr) {
@@ -200,7 +999,6 @@ void CodeGenerator::generateADD(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.add(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLL(const DecodedInstruction &instr) {
@@ -208,7 +1006,6 @@ void CodeGenerator::generateSLL(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.shl(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLT(const DecodedInstruction &instr) {
@@ -216,9 +1013,9 @@ void CodeGenerator::generateSLT(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     // Signed comparison and Set Less (signed)
     compiler_.cmp(op1, op2);
-    compiler_.setl(op1);
+    compiler_.setl(op1.r8());
+    compiler_.movzx(op1.r32(), op1.r8());
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSLTU(const DecodedInstruction &instr) {
@@ -226,9 +1023,9 @@ void CodeGenerator::generateSLTU(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     // Unsigned comparison and Set Less (unsigned)
     compiler_.cmp(op1, op2);
-    compiler_.setb(op1);
+    compiler_.setb(op1.r8());
+    compiler_.movzx(op1.r32(), op1.r8());
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateXOR(const DecodedInstruction &instr) {
@@ -236,7 +1033,6 @@ void CodeGenerator::generateXOR(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.xor_(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSRL(const DecodedInstruction &instr) {
@@ -244,7 +1040,6 @@ void CodeGenerator::generateSRL(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.shr(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateOR(const DecodedInstruction &instr) {
@@ -252,7 +1047,6 @@ void CodeGenerator::generateOR(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.or_(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateAND(const DecodedInstruction &instr) {
@@ -260,7 +1054,6 @@ void CodeGenerator::generateAND(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.and_(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSUB(const DecodedInstruction &instr) {
@@ -268,7 +1061,6 @@ void CodeGenerator::generateSUB(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.sub(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
 }
 
 void CodeGenerator::generateSRA(const DecodedInstruction &instr) {
@@ -276,7 +1068,186 @@ void CodeGenerator::generateSRA(const DecodedInstruction &instr) {
     auto op2 = generateGetReg(instr.rs2);
     compiler_.sar(op1, op2);
     generateSetReg(instr.rd, op1);
-    generateIncrementPC();
+}
+
+void CodeGenerator::generateADDW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.add(op1.r32(), op2.r32());
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSUBW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.sub(op1.r32(), op2.r32());
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+// 32-bit shifts take 5 lower bits of the amount, as RV64 word shifts do
+
+void CodeGenerator::generateSLLW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.shl(op1.r32(), op2);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSRLW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.shr(op1.r32(), op2);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateSRAW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.sar(op1.r32(), op2);
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+template <bool is_signed>
+x86::Gp CodeGenerator::generateMulHigh(const DecodedInstruction &instr) {
+    auto lo = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    auto hi = compiler_.newGpq();
+
+    // One-operand form multiplies by rax and leaves the product in rdx:rax, asmjit pins the registers
+    if constexpr (is_signed) {
+        compiler_.imul(hi, lo, op2);
+    } else {
+        compiler_.mul(hi, lo, op2);
+    }
+    return hi;
+}
+
+template <bool is_signed, bool is_word>
+void CodeGenerator::generateDivRem(const DecodedInstruction &instr, bool is_rem) {
+    auto view = [](x86::Gp reg) { return is_word ? reg.r32() : reg; };
+
+    auto dividend = generateGetReg(instr.rs1);
+    auto divisor = generateGetReg(instr.rs2);
+
+    // x86 traps on division by zero and on signed overflow, while RISC-V defines results for both.
+    // Such divisor is replaced by 1 and the results are patched afterwards, all without branches
+    auto one = compiler_.newGpq();
+    compiler_.mov(one, 1);
+    auto safe_divisor = compiler_.newGpq();
+    compiler_.mov(safe_divisor, divisor);
+    compiler_.test(view(divisor), view(divisor));
+    compiler_.cmovz(safe_divisor, one);
+
+    if constexpr (is_signed) {
+        // MIN / -1 overflows, the expected quotient MIN and remainder 0 are exactly what division by 1 gives
+        auto not_min = compiler_.newGpq();
+        compiler_.mov(not_min, is_word ? static_cast<uint64_t>(INT32_MIN) : static_cast<uint64_t>(INT64_MIN));
+        compiler_.xor_(view(not_min), view(dividend));
+        auto not_minus_one = compiler_.newGpq();
+        compiler_.mov(not_minus_one, divisor);
+        compiler_.not_(view(not_minus_one));
+        compiler_.or_(view(not_min), view(not_minus_one));
+        compiler_.cmovz(safe_divisor, one);
+    }
+
+    auto quot = compiler_.newGpq();
+    auto rem = compiler_.newGpq();
+    compiler_.mov(quot, dividend);
+    if constexpr (is_signed && is_word) {
+        compiler_.cdq(rem.r32(), quot.r32());
+        compiler_.idiv(rem.r32(), quot.r32(), safe_divisor.r32());
+    } else if constexpr (is_signed) {
+        compiler_.cqo(rem, quot);
+        compiler_.idiv(rem, quot, safe_divisor);
+    } else {
+        compiler_.xor_(rem.r32(), rem.r32());
+        compiler_.div(view(rem), view(quot), view(safe_divisor));
+    }
+
+    // Division by zero gives all ones quotient and keeps dividend as remainder
+    auto result = is_rem ? rem : quot;
+    auto zero_result = dividend;
+    if (!is_rem) {
+        zero_result = compiler_.newGpq();
+        compiler_.mov(zero_result, -1);
+    }
+    compiler_.test(view(divisor), view(divisor));
+    compiler_.cmovz(result, zero_result);
+
+    if constexpr (is_word) {
+        compiler_.movsxd(result, result.r32());
+    }
+    generateSetReg(instr.rd, result);
+}
+
+void CodeGenerator::generateMUL(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.imul(op1, op2);
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateMULH(const DecodedInstruction &instr) {
+    generateSetReg(instr.rd, generateMulHigh<true>(instr));
+}
+
+void CodeGenerator::generateMULHSU(const DecodedInstruction &instr) {
+    // Unsigned product is off by rs2 * 2^64 when rs1 is negative
+    auto hi = generateMulHigh<false>(instr);
+    auto fixup = generateGetReg(instr.rs1);
+    compiler_.sar(fixup, 63);
+    compiler_.and_(fixup, generateGetReg(instr.rs2));
+    compiler_.sub(hi, fixup);
+    generateSetReg(instr.rd, hi);
+}
+
+void CodeGenerator::generateMULHU(const DecodedInstruction &instr) {
+    generateSetReg(instr.rd, generateMulHigh<false>(instr));
+}
+
+void CodeGenerator::generateDIV(const DecodedInstruction &instr) {
+    generateDivRem<true, false>(instr, false);
+}
+
+void CodeGenerator::generateDIVU(const DecodedInstruction &instr) {
+    generateDivRem<false, false>(instr, false);
+}
+
+void CodeGenerator::generateREM(const DecodedInstruction &instr) {
+    generateDivRem<true, false>(instr, true);
+}
+
+void CodeGenerator::generateREMU(const DecodedInstruction &instr) {
+    generateDivRem<false, false>(instr, true);
+}
+
+void CodeGenerator::generateMULW(const DecodedInstruction &instr) {
+    auto op1 = generateGetReg(instr.rs1);
+    auto op2 = generateGetReg(instr.rs2);
+    compiler_.imul(op1.r32(), op2.r32());
+    compiler_.movsxd(op1, op1.r32());
+    generateSetReg(instr.rd, op1);
+}
+
+void CodeGenerator::generateDIVW(const DecodedInstruction &instr) {
+    generateDivRem<true, true>(instr, false);
+}
+
+void CodeGenerator::generateDIVUW(const DecodedInstruction &instr) {
+    generateDivRem<false, true>(instr, false);
+}
+
+void CodeGenerator::generateREMW(const DecodedInstruction &instr) {
+    generateDivRem<true, true>(instr, true);
+}
+
+void CodeGenerator::generateREMUW(const DecodedInstruction &instr) {
+    generateDivRem<false, true>(instr, true);
 }
 
 }  // namespace RISCV::compiler
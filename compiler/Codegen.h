@@ -3,7 +3,13 @@
 
 #include <asmjit/asmjit.h>
 
-#include "simulator/Executor.h"
+#include <array>
+#include <vector>
+
+#include "compiler/IR.h"
+#include "compiler/RuntimeHelpers.h"
+#include "simulator/BasicBlock.h"
+#include "simulator/memory/Memory.h"
 
 namespace RISCV::compiler {
 
@@ -11,17 +17,62 @@ class Compiler;
 
 class CodeGenerator {
 public:
-    CodeGenerator(asmjit::CodeHolder *code) : compiler_(code) {}
+    // Optimizing generator is tier 2: it lowers IR and tracks guest registers known at compile time
+    CodeGenerator(asmjit::CodeHolder *code, bool is_optimizing = false)
+        : compiler_(code), is_optimizing_(is_optimizing) {}
 
     void initialize();
     void finalize();
 
-    void generateInvoke(Executor executor, size_t instr_offest);
+    // Tier 1 code calls runtime to queue tier 2 compilation once block is entered TIER_UP_HOTNESS_COUNTER times
+    void generateTierUpCounter();
+
+    // Code got host address of this process as immediate, relocations do not reveal it
+    ALWAYS_INLINE bool hasHostImmediates() const {
+        return has_host_immediates_;
+    }
+
+    // Every exit adds number of instructions executed so far to hart instruction counter.
+    // PC is known statically inside compiled code, hart->pc_ is written only when someone can observe it
+    ALWAYS_INLINE void startInstr(uint64_t pc) {
+        ++instr_count_;
+        instr_pc_ = pc;
+        is_pc_stored_ = false;
+    }
+
+    // GUEST instructions are lowered by the usual emitters below
+    void generateIRInstr(const IRBlock &ir, IRValue value);
+
+    // Calls out-of-line executor of instruction, its copy is embedded into compiled code
+    void generateInvoke(const DecodedInstruction &instr);
+
+    // Leave compiled code through patchable slot or unconditionally return to runtime
+    void generateLinkedExit(BasicBlock::LinkIndex link_index);
+    void generateUnlinkedExit();
+    // Leave compiled code to the block found in inline cache by target PC. Returns try return stack first
+    void generateIndirectExit(asmjit::x86::Gp target, bool is_return);
 
     void generateLUI(const DecodedInstruction &instr);
     void generateAUIPC(const DecodedInstruction &instr);
     void generateJAL(const DecodedInstruction &instr);
     void generateJALR(const DecodedInstruction &instr);
+    void generateBEQ(const DecodedInstruction &instr);
+    void generateBNE(const DecodedInstruction &instr);
+    void generateBLT(const DecodedInstruction &instr);
+    void generateBGE(const DecodedInstruction &instr);
+    void generateBLTU(const DecodedInstruction &instr);
+    void generateBGEU(const DecodedInstruction &instr);
+    void generateLB(const DecodedInstruction &instr);
+    void generateLH(const DecodedInstruction &instr);
+    void generateLW(const DecodedInstruction &instr);
+    void generateLD(const DecodedInstruction &instr);
+    void generateLBU(const DecodedInstruction &instr);
+    void generateLHU(const DecodedInstruction &instr);
+    void generateLWU(const DecodedInstruction &instr);
+    void generateSB(const DecodedInstruction &instr);
+    void generateSH(const DecodedInstruction &instr);
+    void generateSW(const DecodedInstruction &instr);
+    void generateSD(const DecodedInstruction &instr);
     void generateADDI(const DecodedInstruction &instr);
     void generateSLLI(const DecodedInstruction &instr);
     void generateSLTI(const DecodedInstruction &instr);
@@ -31,6 +82,10 @@ public:
     void generateSRAI(const DecodedInstruction &instr);
     void generateORI(const DecodedInstruction &instr);
     void generateANDI(const DecodedInstruction &instr);
+    void generateADDIW(const DecodedInstruction &instr);
+    void generateSLLIW(const DecodedInstruction &instr);
+    void generateSRLIW(const DecodedInstruction &instr);
+    void generateSRAIW(const DecodedInstruction &instr);
     void generateADD(const DecodedInstruction &instr);
     void generateSLL(const DecodedInstruction &instr);
     void generateSLT(const DecodedInstruction &instr);
@@ -41,24 +96,156 @@ public:
     void generateAND(const DecodedInstruction &instr);
     void generateSUB(const DecodedInstruction &instr);
     void generateSRA(const DecodedInstruction &instr);
+    void generateADDW(const DecodedInstruction &instr);
+    void generateSUBW(const DecodedInstruction &instr);
+    void generateSLLW(const DecodedInstruction &instr);
+    void generateSRLW(const DecodedInstruction &instr);
+    void generateSRAW(const DecodedInstruction &instr);
+    void generateMUL(const DecodedInstruction &instr);
+    void generateMULH(const DecodedInstruction &instr);
+    void generateMULHSU(const DecodedInstruction &instr);
+    void generateMULHU(const DecodedInstruction &instr);
+    void generateDIV(const DecodedInstruction &instr);
+    void generateDIVU(const DecodedInstruction &instr);
+    void generateREM(const DecodedInstruction &instr);
+    void generateREMU(const DecodedInstruction &instr);
+    void generateMULW(const DecodedInstruction &instr);
+    void generateDIVW(const DecodedInstruction &instr);
+    void generateDIVUW(const DecodedInstruction &instr);
+    void generateREMW(const DecodedInstruction &instr);
+    void generateREMUW(const DecodedInstruction &instr);
+
+    // Jumps in the middle of trace, PC is known statically from recorded path
+    void generateTraceJAL(const DecodedInstruction &instr, uint64_t pc);
+    void generateTraceGuard(const DecodedInstruction &instr, uint64_t pc, uint64_t next_pc);
 
 private:
+    enum class BranchCondition : uint8_t { EQ, NE, LT, GE, LTU, GEU };
+
+    using GuestRegs = std::array<asmjit::x86::Gp, RegisterType::REGISTER_COUNT>;
+    using ConstRegs = std::array<uint64_t, RegisterType::REGISTER_COUNT>;
+
+    // Leaves trace when guard fails, emitted after the hot path
+    struct SideExit {
+        asmjit::Label label;
+        GuestRegs regs;
+        uint32_t dirty_regs;
+        uint32_t const_regs;
+        ConstRegs const_values;
+        uint64_t pc;
+        size_t instr_count;
+    };
+
+    struct EmbeddedInstr {
+        asmjit::Label label;
+        DecodedInstruction instr;
+    };
+
+    // Call of slow path is between begin and end, see SideTable.h
+    struct SafePointLabels {
+        asmjit::Label begin;
+        asmjit::Label end;
+        uint64_t pc;
+    };
+
+    static BranchCondition getBranchCondition(InstructionType type);
+    static BranchCondition invertCondition(BranchCondition condition);
+    static bool isBranchTaken(BranchCondition condition, uint64_t op1, uint64_t op2);
+
+    ALWAYS_INLINE bool isConstReg(size_t index) const {
+        return index == 0 || (const_regs_ & (1U << index)) != 0;
+    }
+
+    ALWAYS_INLINE uint64_t getConstReg(size_t index) const {
+        return index == 0 ? 0 : const_values_[index];
+    }
+
+    asmjit::x86::Gp generateGetIRValue(const IRBlock &ir, IRValue value);
+    template <typename Operand>
+    void generateIROp(IROpcode opcode, asmjit::x86::Gp dst, const Operand &src);
+
+    // Returns a copy of guest register which can be clobbered by caller
     asmjit::x86::Gp generateGetReg(size_t index);
     void generateSetReg(size_t index, uint64_t imm);
+    // Register becomes the home of guest register, caller must not modify it afterwards
     void generateSetReg(size_t index, asmjit::x86::Gp reg);
 
-    asmjit::x86::Gp generateGetPC();
+    asmjit::x86::Gp generateLoadReg(size_t index);
+    void generateStoreRegs(const GuestRegs &regs, uint32_t mask, uint32_t const_regs, const ConstRegs &const_values);
+    void generateFlushRegs();
+
     void generateSetPC(uint64_t imm);
     void generateSetPC(asmjit::x86::Gp reg);
-    void generateIncrementPC();
+    // Falls through to the next instruction unless current one has already written PC
+    void generateStorePC();
+
+    void generateBranch(const DecodedInstruction &instr, BranchCondition condition);
+    void generateSelect(BranchCondition condition, asmjit::x86::Gp dst, asmjit::x86::Gp src);
+    void generateJump(BranchCondition condition, asmjit::Label label);
+
+    // Call made by block pushes it as caller, calls inlined into trace push none
+    void generatePushReturnAddress(uint64_t return_pc, bool has_caller);
+    // Jumps to found_label with next_bb holding continuation of the call
+    void generatePopReturnAddress(asmjit::x86::Gp target, asmjit::x86::Gp next_bb, asmjit::Label found_label);
+
+    asmjit::x86::Gp generateGetLinkSlot(BasicBlock::LinkIndex link_index);
+    void generateExit(asmjit::x86::Gp link_slot);
+    void generateCountInstrs(size_t count);
+
+    template <typename T>
+    void generateLoad(const DecodedInstruction &instr);
+    template <typename T>
+    void generateStore(const DecodedInstruction &instr);
+    template <memory::MemoryType type, typename T>
+    asmjit::x86::Gp generateTranslate(asmjit::x86::Gp vaddr, asmjit::Label slow_path);
+    asmjit::x86::Gp generateGetSlowPath(InstructionType type);
+    // Slow path call is surrounded by these, guest PC of current instruction is recorded into side table
+    asmjit::Label generateSafePointBegin();
+    void generateSafePointEnd(asmjit::Label begin);
+
+    // Returns high half of 128-bit product
+    template <bool is_signed>
+    asmjit::x86::Gp generateMulHigh(const DecodedInstruction &instr);
+    template <bool is_signed, bool is_word>
+    void generateDivRem(const DecodedInstruction &instr, bool is_rem);
 
     void generatePrint(const char *str, asmjit::x86::Gp reg);
 
     asmjit::x86::Compiler compiler_;
+    bool is_optimizing_;
+    bool has_host_immediates_ = false;
     asmjit::x86::Gp hart_p_;
     asmjit::x86::Gp pc_p_;
     asmjit::x86::Gp regs_p_;
-    asmjit::x86::Gp instr_p_;
+    asmjit::x86::Gp bb_p_;
+    asmjit::x86::Gp pmem_p_;
+    asmjit::x86::Gp helpers_p_;
+
+    // Guest registers live in virtual registers inside compiled block and asmjit maps them onto host registers.
+    // Each one is loaded at its first use and only dirty ones are written back to hart->regs_
+    GuestRegs guest_regs_;
+    uint32_t loaded_regs_ = 0;
+    uint32_t dirty_regs_ = 0;
+    // Tier 2 only. Constant registers are materialized on use and written back as immediates
+    uint32_t const_regs_ = 0;
+    ConstRegs const_values_{};
+
+    // Host registers of IR values, CONST ones are materialized at every use
+    std::vector<asmjit::x86::Gp> ir_values_;
+
+    size_t instr_count_ = 0;
+    // Static PC of instruction being generated
+    uint64_t instr_pc_ = 0;
+    // Current instruction has set hart->pc_ to its successor
+    bool is_pc_stored_ = false;
+    std::vector<SideExit> side_exits_;
+    std::vector<EmbeddedInstr> embedded_instrs_;
+    std::vector<SafePointLabels> safe_points_;
+    // Side table refers to code by offsets from here
+    asmjit::Label code_start_;
+
+    asmjit::Label tier_up_;
+    asmjit::Label tier_up_done_;
 };
 
 }  // namespace RISCV::compiler
@@ -2,21 +2,158 @@
 
 #include <asmjit/asmjit.h>
 
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
 #include "compiler/Codegen.h"
 #include "generated/InstructionTypes.h"
-#include "simulator/Executor-inl.h"
 #include "simulator/Hart.h"
 
 namespace RISCV::compiler {
 
 using namespace asmjit;
 
+bool Compiler::isAheadOfTimeEnabled() {
+    const char *env = std::getenv(AOT_ENV);
+    return env != nullptr && *env != '\0' && std::strcmp(env, "0") != 0;
+}
+
+Compiler::Dispatcher Compiler::getDispatcher() {
+    if (dispatcher_ == nullptr) {
+        dispatcher_ = generateDispatcher();
+    }
+    return dispatcher_;
+}
+
+// Loop over cached blocks which does what runtime does for every block, but stays in generated code while the next
+// block is found in block cache and needs nothing from runtime. Compiled blocks are called directly and chained by
+// their exits, other blocks go through executeBasicBlock helper. Control returns to runtime on cache miss, trace,
+// code collection, trace recording and PC == 0
+Compiler::Dispatcher Compiler::generateDispatcher() {
+    CodeHolder code;
+    code.init(code_cache_.getEnvironment(), code_cache_.getCpuFeatures());
+    x86::Compiler cc(&code);
+
+    static auto dispatcher_signature = FuncSignatureT<void, Hart *>();
+    auto *func_node = cc.addFunc(dispatcher_signature);
+    auto hart_p = cc.newGpq();
+    func_node->setArg(0, hart_p);
+
+    auto helpers_p = cc.newGpq();
+    cc.mov(helpers_p, x86::qword_ptr(hart_p, Hart::getOffsetToHelpers()));
+    // Dispatcher is not saved by persistent cache, so it can refer to this process
+    auto collection_flag_p = cc.newGpq();
+    cc.mov(collection_flag_p, reinterpret_cast<uint64_t>(code_cache_.getCollectionFlag()));
+
+    auto pc = cc.newGpq();
+    auto slot = cc.newGpq();
+    auto bb = cc.newGpq();
+    auto next_bb = cc.newGpq();
+    auto entrypoint = cc.newGpq();
+
+    auto loop = cc.newLabel();
+    auto chain = cc.newLabel();
+    auto chain_end = cc.newLabel();
+    auto slow_path = cc.newLabel();
+    auto exit = cc.newLabel();
+
+    cc.bind(loop);
+    cc.mov(pc, x86::qword_ptr(hart_p, Hart::getOffsetToPc()));
+    cc.test(pc, pc);
+    cc.jz(exit);
+    cc.cmp(x86::byte_ptr(collection_flag_p), 0);
+    cc.jne(exit);
+    cc.cmp(x86::byte_ptr(hart_p, Hart::getOffsetToIsRecording()), 0);
+    cc.jne(exit);
+
+    // Inline BBCache::find
+    cc.mov(slot, pc);
+    cc.and_(slot, Hart::BB_CACHE_CAPACITY - 1);
+    cc.imul(slot, slot, Hart::getBBCacheSlotSize());
+    cc.add(slot, hart_p);
+    cc.cmp(x86::qword_ptr(slot, Hart::getOffsetToBBCacheSlots() + Hart::getBBCacheSlotKeyOffset()), pc);
+    cc.jne(exit);
+    cc.lea(bb, x86::ptr(slot, Hart::getOffsetToBBCacheSlots() + Hart::getBBCacheSlotBlockOffset()));
+
+    // Runtime switches the block to its trace
+    cc.cmp(x86::byte_ptr(bb, BasicBlock::getOffsetToHasTrace()), 0);
+    cc.jne(exit);
+
+    // Interpreted blocks, pending links and back edges, which can start trace recording, are left to runtime
+    cc.cmp(x86::byte_ptr(bb, BasicBlock::getOffsetToCompilationStatus()),
+           static_cast<uint8_t>(CompilationStatus::COMPILED));
+    cc.jne(slow_path);
+    cc.cmp(x86::qword_ptr(hart_p, Hart::getOffsetToPendingLink()), 0);
+    cc.jne(slow_path);
+    cc.cmp(x86::qword_ptr(hart_p, Hart::getOffsetToPendingIndirectLink()), 0);
+    cc.jne(slow_path);
+    cc.cmp(x86::qword_ptr(hart_p, Hart::getOffsetToPendingReturnLink()), 0);
+    cc.jne(slow_path);
+    cc.mov(entrypoint, x86::qword_ptr(bb, BasicBlock::getOffsetToEntrypoint()));
+    cc.cmp(entrypoint, x86::qword_ptr(hart_p, Hart::getOffsetToLastEntrypoint()));
+    cc.jbe(slow_path);
+
+    // Same as chaining loop of Hart::executeBasicBlock
+    static auto entry_signature = FuncSignatureT<BasicBlock *, Hart *, BasicBlock *>();
+    cc.bind(chain);
+    auto entry = cc.newGpq();
+    cc.mov(entry, x86::qword_ptr(bb, BasicBlock::getOffsetToCompiledEntry()));
+    InvokeNode *entry_node = nullptr;
+    cc.invoke(&entry_node, entry, entry_signature);
+    entry_node->setArg(0, hart_p);
+    entry_node->setArg(1, bb);
+    entry_node->setRet(0, next_bb);
+    cc.test(next_bb, next_bb);
+    cc.jz(chain_end);
+    cc.mov(entrypoint, x86::qword_ptr(next_bb, BasicBlock::getOffsetToEntrypoint()));
+    cc.cmp(entrypoint, x86::qword_ptr(bb, BasicBlock::getOffsetToEntrypoint()));
+    // Back edge is taken through the lookup, which sends it to runtime
+    cc.jbe(chain_end);
+    cc.mov(bb, next_bb);
+    cc.jmp(chain);
+
+    cc.bind(chain_end);
+    cc.mov(entrypoint, x86::qword_ptr(bb, BasicBlock::getOffsetToEntrypoint()));
+    cc.mov(x86::qword_ptr(hart_p, Hart::getOffsetToLastEntrypoint()), entrypoint);
+    cc.jmp(loop);
+
+    cc.bind(slow_path);
+    auto execute_block = cc.newGpq();
+    cc.mov(execute_block, x86::qword_ptr(helpers_p, offsetof(RuntimeHelpers, execute_block)));
+    static auto execute_block_signature = FuncSignatureT<void, Hart *, BasicBlock *>();
+    InvokeNode *execute_node = nullptr;
+    cc.invoke(&execute_node, execute_block, execute_block_signature);
+    execute_node->setArg(0, hart_p);
+    execute_node->setArg(1, bb);
+    cc.jmp(loop);
+
+    cc.bind(exit);
+    cc.ret();
+    cc.endFunc();
+
+    cc.finalize();
+    return reinterpret_cast<Dispatcher>(code_cache_.addStub(code));
+}
+
+std::optional<uint64_t> Compiler::findGuestPC(const void *return_address) {
+    auto code = code_cache_.findCode(return_address);
+    if (code == std::nullopt) {
+        code = persistent_cache_.findCode(return_address);
+    }
+    if (code == std::nullopt) {
+        return std::nullopt;
+    }
+    return findSafePointPC(*code, return_address);
+}
+
 bool Compiler::decrementHotnessCounter(BasicBlock &bb) {
     auto status = bb.getCompilationStatus(std::memory_order_acquire);
     switch (status) {
         case CompilationStatus::NOT_COMPILED:
             break;
         case CompilationStatus::COMPILING:
+            bb.incrementPendingExecutions();
             return true;
         case CompilationStatus::COMPILED:
             return false;
@@ -30,227 +167,419 @@ bool Compiler::decrementHotnessCounter(BasicBlock &bb) {
 
     bb.setCompilationStatus(CompilationStatus::COMPILING, std::memory_order_relaxed);
     CompilerTask compiler_task{bb.getBody(), bb.getEntrypoint()};
+    compiler_task.pending_executions = bb.startPendingExecutions();
     worker_.addTask(std::move(compiler_task));
     return true;
 }
 
-void Compiler::compileBasicBlock(CompilerTask &&task) {
+void Compiler::optimizeBasicBlock(const BasicBlock &bb) {
+    CompilerTask compiler_task{bb.getBody(), bb.getEntrypoint()};
+    compiler_task.is_optimized = true;
+    worker_.addTask(std::move(compiler_task));
+}
+
+bool Compiler::isRelocatable(const CodeHolder &code) {
+    for (const RelocEntry *reloc : code.relocEntries()) {
+        if (reloc->relocType() == RelocType::kAbsToAbs || reloc->relocType() == RelocType::kX64AddressEntry) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Compiler::isTaskAlive(const CompilerTask &task) {
+    if (task.isTrace()) {
+        return hart_->isTraceCompiling(task.entrypoint);
+    }
+    if (task.is_optimized) {
+        return hart_->isBBCompiled(task.entrypoint);
+    }
+    return hart_->isBBCompiling(task.entrypoint);
+}
+
+void Compiler::compileTrace(BasicBlock &trace, std::vector<BasicBlock::Entrypoint> pcs) {
+    ASSERT(trace.isTrace() && pcs.size() == trace.getInstrCount());
+    trace.setCompilationStatus(CompilationStatus::COMPILING, std::memory_order_relaxed);
+    CompilerTask compiler_task{trace.getBody(), trace.getEntrypoint(), std::move(pcs)};
+    // Traces are recorded only from hot loops and start at tier 2 right away
+    compiler_task.is_optimized = true;
+    worker_.addTask(std::move(compiler_task));
+}
+
+Compiler::CompiledEntry Compiler::generateCode(const CompilerTask &task) {
     CodeHolder code;
-    code.init(runtime_.environment(), runtime_.cpuFeatures());
-    CodeGenerator codegen(&code);
+    code.init(code_cache_.getEnvironment(), code_cache_.getCpuFeatures());
+    CodeGenerator codegen(&code, task.is_optimized);
     codegen.initialize();
 
-    for (size_t i = 0; i < task.instrs.size(); ++i) {
-        if (task.instrs[i].type != InstructionType::BASIC_BLOCK_END) {
-            generateInstr(codegen, task.instrs[i], i);
+    ASSERT(task.instrs.size() >= 2);
+    const size_t last_offset = task.instrs.size() - 2;
+    if (task.is_optimized) {
+        if (!generateIR(codegen, task)) {
+            return nullptr;
+        }
+    } else {
+        // Tier 1 code counts its executions and asks for tier 2 once the block is hot
+        codegen.generateTierUpCounter();
+        for (size_t i = 0; i <= last_offset; ++i) {
+            codegen.startInstr(task.getPC(i));
+            if (!generateGuestInstr(codegen, task, i)) {
+                return nullptr;
+            }
         }
     }
 
+    // Jumps and branches emit their own exits
+    const auto &last_instr = task.instrs[last_offset];
+    if (last_instr.type == InstructionType::ECALL) {
+        codegen.generateUnlinkedExit();
+    } else if (!last_instr.isJumpInstruction()) {
+        codegen.generateLinkedExit(BasicBlock::FALLTHROUGH_LINK);
+    }
+
     codegen.finalize();
-    CompiledEntry entry = nullptr;
-    runtime_.add(&entry, &code);
-    hart_->setBBEntry(task.entrypoint, entry);
+    CompiledEntry entry = code_cache_.add(code, task.entrypoint, task.isTrace());
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    const size_t code_size = code_cache_.getSize();
+    if (code_size > getStats().max_code_size.load(std::memory_order_relaxed)) {
+        getStats().max_code_size.store(code_size, std::memory_order_relaxed);
+    }
+
+    // Traces depend on the path taken by this run, only tier 1 code of blocks is saved. It tiers up in the next run
+    // the same way
+    if (!task.is_optimized && !codegen.hasHostImmediates() && isRelocatable(code)) {
+        persistent_cache_.store(task.entrypoint, reinterpret_cast<const void *>(entry), code.codeSize());
+    }
+    getStats().compiled.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+}
+
+bool Compiler::generateIR(CodeGenerator &codegen, const CompilerTask &task) {
+    auto ir = IRBlock::build(task);
+    ir.optimize();
+
+    const auto &instrs = ir.getInstrs();
+    IRValue value = 0;
+    for (size_t offset = 0; offset + 1 < task.instrs.size(); ++offset) {
+        codegen.startInstr(task.getPC(offset));
+
+        for (; value < instrs.size() && instrs[value].offset == offset; ++value) {
+            if (instrs[value].opcode != IROpcode::GUEST) {
+                codegen.generateIRInstr(ir, value);
+                continue;
+            }
+            if (!generateGuestInstr(codegen, task, offset)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-void Compiler::generateInstr(CodeGenerator &codegen, const DecodedInstruction &instr, size_t instr_offset) {
+bool Compiler::generateGuestInstr(CodeGenerator &codegen, const CompilerTask &task, size_t offset) {
+    const auto &instr = task.instrs[offset];
+    if (task.isTrace() && offset + 2 != task.instrs.size() && instr.isJumpInstruction()) {
+        generateTraceInstr(codegen, instr, task.pcs[offset], task.pcs[offset + 1]);
+        return true;
+    }
+    return generateInstr(codegen, instr);
+}
+
+void Compiler::compileBasicBlock(CompilerTask &&task) {
+    // Block with unsupported instruction stays in COMPILING state and is interpreted from now on
+    CompiledEntry entry = generateCode(task);
+    if (entry == nullptr) {
+        return;
+    }
+
+    bool is_installed = false;
+    if (task.isTrace()) {
+        is_installed = hart_->setTraceEntry(task.entrypoint, entry);
+    } else if (task.is_optimized) {
+        is_installed = hart_->setOptimizedBBEntry(task.entrypoint, entry);
+        if (is_installed) {
+            getStats().optimized.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        is_installed = hart_->setBBEntry(task.entrypoint, entry);
+    }
+
+    if (!is_installed) {
+        getStats().wasted.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Code is installed or left for the block fetched again, so it can be evicted now
+    code_cache_.unpin(entry);
+}
+
+std::vector<CodeCache::Victim> Compiler::collectCode(
+    const std::function<bool(const CodeCache::Record &)> &is_installed) {
+    auto victims = code_cache_.collect(is_installed);
+    for (const auto &victim : victims) {
+        if (victim.is_replaced) {
+            getStats().released.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            getStats().evicted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return victims;
+}
+
+void Compiler::compileAheadOfTime(const std::vector<BasicBlock> &blocks) {
+    std::vector<CompilerTask> tasks;
+    tasks.reserve(blocks.size());
+    for (const auto &bb : blocks) {
+        // Code saved by previous run is installed on fetch anyway
+        if (persistent_cache_.find(bb.getEntrypoint()) == nullptr) {
+            tasks.push_back(CompilerTask{bb.getBody(), bb.getEntrypoint()});
+        }
+    }
+
+    std::vector<CompiledEntry> entries(tasks.size(), nullptr);
+    std::atomic<size_t> next_task{0};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < worker_.getThreadsCount(); ++i) {
+        threads.emplace_back([this, &tasks, &entries, &next_task] {
+            for (size_t idx = next_task.fetch_add(1); idx < tasks.size(); idx = next_task.fetch_add(1)) {
+                entries[idx] = generateCode(tasks[idx]);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    size_t compiled_count = 0;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (entries[i] != nullptr) {
+            code_cache_.unpin(entries[i]);
+            ++compiled_count;
+        }
+    }
+    getStats().ahead_of_time.store(compiled_count, std::memory_order_relaxed);
+}
+
+void Compiler::generateTraceInstr(CodeGenerator &codegen, const DecodedInstruction &instr, BasicBlock::Entrypoint pc,
+                                  BasicBlock::Entrypoint next_pc) {
+    switch (instr.type) {
+        case InstructionType::JAL:
+            codegen.generateTraceJAL(instr, pc);
+            return;
+        case InstructionType::BEQ:
+        case InstructionType::BNE:
+        case InstructionType::BLT:
+        case InstructionType::BGE:
+        case InstructionType::BLTU:
+        case InstructionType::BGEU:
+            codegen.generateTraceGuard(instr, pc, next_pc);
+            return;
+        default:
+            // Recording stops at indirect jumps and syscalls
+            UNREACHABLE();
+    }
+}
+
+bool Compiler::generateInstr(CodeGenerator &codegen, const DecodedInstruction &instr) {
     switch (instr.type) {
         case InstructionType::LUI:
             codegen.generateLUI(instr);
-            return;
+            return true;
         case InstructionType::AUIPC:
             codegen.generateAUIPC(instr);
-            return;
+            return true;
         case InstructionType::JAL:
             codegen.generateJAL(instr);
-            return;
+            return true;
         case InstructionType::JALR:
             codegen.generateJALR(instr);
-            return;
+            return true;
         case InstructionType::BEQ:
-            codegen.generateInvoke(ExecutorBEQ, instr_offset);
-            return;
+            codegen.generateBEQ(instr);
+            return true;
         case InstructionType::BNE:
-            codegen.generateInvoke(ExecutorBNE, instr_offset);
-            return;
+            codegen.generateBNE(instr);
+            return true;
         case InstructionType::BLT:
-            codegen.generateInvoke(ExecutorBLT, instr_offset);
-            return;
+            codegen.generateBLT(instr);
+            return true;
         case InstructionType::BGE:
-            codegen.generateInvoke(ExecutorBGE, instr_offset);
-            return;
+            codegen.generateBGE(instr);
+            return true;
         case InstructionType::BLTU:
-            codegen.generateInvoke(ExecutorBLTU, instr_offset);
-            return;
+            codegen.generateBLTU(instr);
+            return true;
         case InstructionType::BGEU:
-            codegen.generateInvoke(ExecutorBGEU, instr_offset);
-            return;
+            codegen.generateBGEU(instr);
+            return true;
         case InstructionType::LB:
-            codegen.generateInvoke(ExecutorLB, instr_offset);
-            return;
+            codegen.generateLB(instr);
+            return true;
         case InstructionType::LH:
-            codegen.generateInvoke(ExecutorLH, instr_offset);
-            return;
+            codegen.generateLH(instr);
+            return true;
         case InstructionType::LW:
-            codegen.generateInvoke(ExecutorLW, instr_offset);
-            return;
+            codegen.generateLW(instr);
+            return true;
         case InstructionType::LD:
-            codegen.generateInvoke(ExecutorLD, instr_offset);
-            return;
+            codegen.generateLD(instr);
+            return true;
         case InstructionType::LBU:
-            codegen.generateInvoke(ExecutorLBU, instr_offset);
-            return;
+            codegen.generateLBU(instr);
+            return true;
         case InstructionType::LHU:
-            codegen.generateInvoke(ExecutorLHU, instr_offset);
-            return;
+            codegen.generateLHU(instr);
+            return true;
         case InstructionType::LWU:
-            codegen.generateInvoke(ExecutorLWU, instr_offset);
-            return;
+            codegen.generateLWU(instr);
+            return true;
         case InstructionType::SB:
-            codegen.generateInvoke(ExecutorSB, instr_offset);
-            return;
+            codegen.generateSB(instr);
+            return true;
         case InstructionType::SH:
-            codegen.generateInvoke(ExecutorSH, instr_offset);
-            return;
+            codegen.generateSH(instr);
+            return true;
         case InstructionType::SW:
-            codegen.generateInvoke(ExecutorSW, instr_offset);
-            return;
+            codegen.generateSW(instr);
+            return true;
         case InstructionType::SD:
-            codegen.generateInvoke(ExecutorSD, instr_offset);
-            return;
+            codegen.generateSD(instr);
+            return true;
         case InstructionType::ADDI:
             codegen.generateADDI(instr);
-            return;
+            return true;
         case InstructionType::SLLI:
             codegen.generateSLLI(instr);
-            return;
+            return true;
         case InstructionType::SLTI:
             codegen.generateSLTI(instr);
-            return;
+            return true;
         case InstructionType::SLTIU:
             codegen.generateSLTIU(instr);
-            return;
+            return true;
         case InstructionType::XORI:
             codegen.generateXORI(instr);
-            return;
+            return true;
         case InstructionType::SRLI:
             codegen.generateSRLI(instr);
-            return;
+            return true;
         case InstructionType::SRAI:
             codegen.generateSRAI(instr);
-            return;
+            return true;
         case InstructionType::ORI:
             codegen.generateORI(instr);
-            return;
+            return true;
         case InstructionType::ANDI:
             codegen.generateANDI(instr);
-            return;
+            return true;
         case InstructionType::ADDIW:
-            codegen.generateInvoke(ExecutorADDIW, instr_offset);
-            return;
+            codegen.generateADDIW(instr);
+            return true;
         case InstructionType::SLLIW:
-            codegen.generateInvoke(ExecutorSLLIW, instr_offset);
-            return;
+            codegen.generateSLLIW(instr);
+            return true;
         case InstructionType::SRLIW:
-            codegen.generateInvoke(ExecutorSRLIW, instr_offset);
-            return;
+            codegen.generateSRLIW(instr);
+            return true;
         case InstructionType::SRAIW:
-            codegen.generateInvoke(ExecutorSRAIW, instr_offset);
-            return;
+            codegen.generateSRAIW(instr);
+            return true;
         case InstructionType::ADD:
             codegen.generateADD(instr);
-            return;
+            return true;
         case InstructionType::SLL:
             codegen.generateSLL(instr);
-            return;
+            return true;
         case InstructionType::SLT:
             codegen.generateSLT(instr);
-            return;
+            return true;
         case InstructionType::SLTU:
             codegen.generateSLTU(instr);
-            return;
+            return true;
         case InstructionType::XOR:
             codegen.generateXOR(instr);
-            return;
+            return true;
         case InstructionType::SRL:
             codegen.generateSRL(instr);
-            return;
+            return true;
         case InstructionType::OR:
             codegen.generateOR(instr);
-            return;
+            return true;
         case InstructionType::AND:
             codegen.generateAND(instr);
-            return;
+            return true;
         case InstructionType::SUB:
             codegen.generateSUB(instr);
-            return;
+            return true;
         case InstructionType::SRA:
             codegen.generateSRA(instr);
-            return;
+            return true;
         case InstructionType::ADDW:
-            codegen.generateInvoke(ExecutorADDW, instr_offset);
-            return;
+            codegen.generateADDW(instr);
+            return true;
         case InstructionType::SUBW:
-            codegen.generateInvoke(ExecutorSUBW, instr_offset);
-            return;
+            codegen.generateSUBW(instr);
+            return true;
         case InstructionType::SLLW:
-            codegen.generateInvoke(ExecutorSLLW, instr_offset);
-            return;
+            codegen.generateSLLW(instr);
+            return true;
         case InstructionType::SRLW:
-            codegen.generateInvoke(ExecutorSRLW, instr_offset);
-            return;
+            codegen.generateSRLW(instr);
+            return true;
         case InstructionType::SRAW:
-            codegen.generateInvoke(ExecutorSRAW, instr_offset);
-            return;
+            codegen.generateSRAW(instr);
+            return true;
         case InstructionType::FENCE:
-            codegen.generateInvoke(ExecutorFENCE, instr_offset);
-            return;
+            codegen.generateInvoke(instr);
+            return true;
         case InstructionType::ECALL:
-            codegen.generateInvoke(ExecutorECALL, instr_offset);
-            return;
+            codegen.generateInvoke(instr);
+            return true;
         case InstructionType::EBREAK:
-            codegen.generateInvoke(ExecutorEBREAK, instr_offset);
-            return;
+            codegen.generateInvoke(instr);
+            return true;
         case InstructionType::MUL:
-            codegen.generateInvoke(ExecutorMUL, instr_offset);
-            return;
+            codegen.generateMUL(instr);
+            return true;
         case InstructionType::MULH:
-            codegen.generateInvoke(ExecutorMULH, instr_offset);
-            return;
+            codegen.generateMULH(instr);
+            return true;
         case InstructionType::MULHSU:
-            codegen.generateInvoke(ExecutorMULHSU, instr_offset);
-            return;
+            codegen.generateMULHSU(instr);
+            return true;
         case InstructionType::MULHU:
-            codegen.generateInvoke(ExecutorMULHU, instr_offset);
-            return;
+            codegen.generateMULHU(instr);
+            return true;
         case InstructionType::DIV:
-            codegen.generateInvoke(ExecutorDIV, instr_offset);
-            return;
+            codegen.generateDIV(instr);
+            return true;
         case InstructionType::DIVU:
-            codegen.generateInvoke(ExecutorDIVU, instr_offset);
-            return;
+            codegen.generateDIVU(instr);
+            return true;
         case InstructionType::REM:
-            codegen.generateInvoke(ExecutorREM, instr_offset);
-            return;
+            codegen.generateREM(instr);
+            return true;
         case InstructionType::REMU:
-            codegen.generateInvoke(ExecutorREMU, instr_offset);
-            return;
+            codegen.generateREMU(instr);
+            return true;
         case InstructionType::MULW:
-            codegen.generateInvoke(ExecutorMULW, instr_offset);
-            return;
+            codegen.generateMULW(instr);
+            return true;
         case InstructionType::DIVW:
-            codegen.generateInvoke(ExecutorDIVW, instr_offset);
-            return;
+            codegen.generateDIVW(instr);
+            return true;
         case InstructionType::DIVUW:
-            codegen.generateInvoke(ExecutorDIVUW, instr_offset);
-            return;
+            codegen.generateDIVUW(instr);
+            return true;
         case InstructionType::REMW:
-            codegen.generateInvoke(ExecutorREMW, instr_offset);
-            return;
+            codegen.generateREMW(instr);
+            return true;
         case InstructionType::REMUW:
-            codegen.generateInvoke(ExecutorREMUW, instr_offset);
-            return;
+            codegen.generateREMUW(instr);
+            return true;
         default:
-            UNREACHABLE();
+            return false;
     }
 
     UNREACHABLE();
@@ -3,7 +3,12 @@
 
 #include <asmjit/asmjit.h>
 
+#include <functional>
+#include <vector>
+
+#include "compiler/CodeCache.h"
 #include "compiler/CompilerWorker.h"
+#include "compiler/PersistentCache.h"
 #include "simulator/BasicBlock.h"
 
 namespace RISCV {
@@ -17,9 +22,16 @@ class CodeGenerator;
 class Compiler {
 public:
     using CompiledEntry = BasicBlock::CompiledEntry;
+    // Runs blocks until runtime has to take control, see generateDispatcher
+    using Dispatcher = void (*)(Hart *);
+
+    // Non-empty value other than "0" enables translation of the whole program before execution
+    static constexpr const char *AOT_ENV = "RISCV_AOT";
 
     Compiler(Hart *hart) : hart_(hart), worker_(this) {}
 
+    static bool isAheadOfTimeEnabled();
+
     void InitializeWorker() {
         worker_.Initialize();
     }
@@ -28,14 +40,83 @@ public:
         worker_.Finalize();
     }
 
+    ALWAYS_INLINE CompilerStats &getStats() {
+        return worker_.getStats();
+    }
+
+    ALWAYS_INLINE size_t getQueueDepth() {
+        return worker_.getQueueDepth();
+    }
+
+    void openPersistentCache(uint64_t program_hash) {
+        persistent_cache_.open(program_hash);
+    }
+
+    // Installs code compiled earlier in this run or by previous run into just fetched block.
+    // Compiled code outlives blocks, so evicted block is not interpreted and compiled again once it is fetched back
+    ALWAYS_INLINE void installPrecompiledCode(BasicBlock &bb) {
+        CompiledEntry entry = code_cache_.find(bb.getEntrypoint());
+        if (entry == nullptr) {
+            entry = persistent_cache_.find(bb.getEntrypoint());
+        }
+        if (entry != nullptr) {
+            getStats().precompiled.fetch_add(1, std::memory_order_relaxed);
+            bb.setCompiledEntry(entry);
+            bb.setCompilationStatus(CompilationStatus::COMPILED, std::memory_order_relaxed);
+        }
+    }
+
+    ALWAYS_INLINE bool needsCodeCollection() const {
+        return code_cache_.needsCollection();
+    }
+
+    // Called by runtime outside of compiled code. Blocks holding victims must be detached from them before release
+    std::vector<CodeCache::Victim> collectCode(const std::function<bool(const CodeCache::Record &)> &is_installed);
+    void releaseCode(const std::vector<CodeCache::Victim> &victims) {
+        code_cache_.release(victims);
+    }
+
+    // Returns nullptr if dispatcher could not be generated, runtime dispatches every block itself then
+    Dispatcher getDispatcher();
+
+    // PC of guest instruction whose slow path call returns to the address
+    std::optional<uint64_t> findGuestPC(const void *return_address);
+
     bool decrementHotnessCounter(BasicBlock &bb);
+    // Queues tier 2 compilation of block running tier 1 code
+    void optimizeBasicBlock(const BasicBlock &bb);
+    // Task is worth compiling only while its block is still cached and waits for compiled code
+    bool isTaskAlive(const CompilerTask &task);
+    void compileTrace(BasicBlock &trace, std::vector<BasicBlock::Entrypoint> pcs);
     void compileBasicBlock(CompilerTask &&task);
-    void generateInstr(CodeGenerator &codegen, const DecodedInstruction &instr, size_t instr_offset);
+    // Blocks are compiled by all worker threads, runtime waits until they are done
+    void compileAheadOfTime(const std::vector<BasicBlock> &blocks);
+    // Returns false for instructions compiled code can not execute
+    bool generateInstr(CodeGenerator &codegen, const DecodedInstruction &instr);
+    // Jumps inside trace continue along the recorded path instead of leaving compiled code
+    void generateTraceInstr(CodeGenerator &codegen, const DecodedInstruction &instr, BasicBlock::Entrypoint pc,
+                            BasicBlock::Entrypoint next_pc);
 
 private:
+    // Returns nullptr if task contains unsupported instruction
+    CompiledEntry generateCode(const CompilerTask &task);
+    // Tier 2: body goes through IR and its optimizations before CodeGenerator
+    bool generateIR(CodeGenerator &codegen, const CompilerTask &task);
+    bool generateGuestInstr(CodeGenerator &codegen, const CompilerTask &task, size_t offset);
+
+    // Code which refers to absolute addresses can not be reused by another process. Only relocations are checked here:
+    // persisted code has to reach every process specific address through hart_p_, helpers_p_ or raw_memory_, and
+    // codegen reports host addresses it puts into immediates by itself
+    static bool isRelocatable(const asmjit::CodeHolder &code);
+
+    Dispatcher generateDispatcher();
+
     Hart *hart_;
     CompilerWorker worker_;
-    asmjit::JitRuntime runtime_;
+    // Workers generate code in their own CodeHolder, only publishing into code cache is serialized
+    CodeCache code_cache_;
+    PersistentCache persistent_cache_;
+    Dispatcher dispatcher_ = nullptr;
 };
 
 }  // namespace RISCV::compiler
@@ -1,19 +1,36 @@
 #include "compiler/CompilerWorker.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
 #include "compiler/Compiler.h"
 
 namespace RISCV::compiler {
 
 void CompilerTaskQueue::addTask(CompilerTask &&task) {
-    bool is_empty = false;
     {
         std::unique_lock holder(queue_lock_);
-        is_empty = compiler_tasks_.empty();
+        // Block was evicted and fetched again while its first task is still waiting
+        if (!queued_keys_.insert(task.getKey()).second) {
+            // Waiting task counts executions of the block fetched again, since the evicted one never runs
+            auto queued = std::find_if(compiler_tasks_.begin(), compiler_tasks_.end(),
+                                       [&task](const CompilerTask &other) { return other.getKey() == task.getKey(); });
+            if (queued != compiler_tasks_.end()) {
+                queued->pending_executions = std::move(task.pending_executions);
+            }
+            stats_->deduplicated.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
         compiler_tasks_.emplace_back(std::move(task));
+
+        const size_t depth = compiler_tasks_.size();
+        if (depth > stats_->max_queue_depth.load(std::memory_order_relaxed)) {
+            stats_->max_queue_depth.store(depth, std::memory_order_relaxed);
+        }
     }
-    if (is_empty) {
-        is_empty_or_closed_.notify_one();
-    }
+    // Every task may be taken by its own idle worker
+    is_empty_or_closed_.notify_one();
 }
 
 std::optional<CompilerTask> CompilerTaskQueue::getTask() {
@@ -26,31 +43,73 @@ std::optional<CompilerTask> CompilerTaskQueue::getTask() {
         return std::nullopt;
     }
 
-    auto task = std::move(compiler_tasks_.front());
-    compiler_tasks_.pop_front();
+    // Counters keep changing while the queue is scanned, so every priority is read once
+    auto hottest = compiler_tasks_.begin();
+    uint32_t hottest_priority = hottest->getPriority();
+    for (auto task = std::next(hottest); task != compiler_tasks_.end(); ++task) {
+        const uint32_t priority = task->getPriority();
+        if (priority > hottest_priority) {
+            hottest = task;
+            hottest_priority = priority;
+        }
+    }
+    auto task = std::move(*hottest);
+    if (hottest != std::prev(compiler_tasks_.end())) {
+        *hottest = std::move(compiler_tasks_.back());
+    }
+    compiler_tasks_.pop_back();
+    queued_keys_.erase(task.getKey());
     return task;
 }
 
+size_t CompilerTaskQueue::getDepth() {
+    std::unique_lock holder(queue_lock_);
+    return compiler_tasks_.size();
+}
+
 void CompilerTaskQueue::close() {
-    is_closed_.store(true, std::memory_order_release);
-    is_empty_or_closed_.notify_one();
+    {
+        // Waiting worker must not miss the flag between its check and wait
+        std::unique_lock holder(queue_lock_);
+        is_closed_.store(true, std::memory_order_release);
+    }
+    is_empty_or_closed_.notify_all();
 }
 
 bool CompilerTaskQueue::isClosed() {
     return is_closed_.load(std::memory_order_acquire);
 }
 
-void CompilerWorker::Initialize() {
-    worker_thread_ = std::thread([this] {
-        while (!task_queue_.isClosed()) {
-            processTask();
+size_t CompilerWorker::getDefaultThreadsCount() {
+    const char *env = std::getenv(THREADS_COUNT_ENV);
+    if (env != nullptr) {
+        const long threads_count = std::strtol(env, nullptr, 10);
+        if (threads_count > 0) {
+            return threads_count;
         }
-    });
+    }
+
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    return std::max<size_t>(hardware_threads, 2) - 1;
+}
+
+void CompilerWorker::Initialize() {
+    worker_threads_.reserve(threads_count_);
+    for (size_t i = 0; i < threads_count_; ++i) {
+        worker_threads_.emplace_back([this] {
+            while (!task_queue_.isClosed()) {
+                processTask();
+            }
+        });
+    }
 }
 
 void CompilerWorker::Finalize() {
     task_queue_.close();
-    worker_thread_.join();
+    for (auto &worker_thread : worker_threads_) {
+        worker_thread.join();
+    }
+    worker_threads_.clear();
 }
 
 void CompilerWorker::processTask() {
@@ -58,6 +117,11 @@ void CompilerWorker::processTask() {
     if (task == std::nullopt) {
         return;
     }
+
+    if (!compiler_->isTaskAlive(*task)) {
+        stats_.cancelled.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     compiler_->compileBasicBlock(std::move(*task));
 }
 
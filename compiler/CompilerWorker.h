@@ -1,11 +1,14 @@
 #ifndef INCLUDE_COMPILER_WORKER_H_
 #define INCLUDE_COMPILER_WORKER_H_
 
+#include <atomic>
 #include <condition_variable>
-#include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "simulator/BasicBlock.h"
 #include "utils/macros.h"
@@ -22,26 +25,101 @@ public:
 
     BasicBlock::Body instrs;
     BasicBlock::Entrypoint entrypoint;
+    // Guest PC of every instruction, filled only for traces
+    std::vector<BasicBlock::Entrypoint> pcs;
+    // Executions of the block while it waits in queue, set only for tier 1 tasks. Counter is owned together with the
+    // block, so it stays valid after eviction
+    std::shared_ptr<const std::atomic<uint32_t>> pending_executions;
+    // Tier 2 compilation, traces are always optimized
+    bool is_optimized = false;
+
+    ALWAYS_INLINE bool isTrace() const {
+        return !pcs.empty();
+    }
+
+    ALWAYS_INLINE BasicBlock::Entrypoint getPC(size_t offset) const {
+        return isTrace() ? pcs[offset] : entrypoint + INSTRUCTION_BYTESIZE * offset;
+    }
+
+    // Entrypoints are aligned, so the lowest bits distinguish trace and tier 2 block from block starting at the same
+    // address
+    ALWAYS_INLINE uint64_t getKey() const {
+        return entrypoint | static_cast<uint64_t>(isTrace()) | (static_cast<uint64_t>(is_optimized) << 1);
+    }
+
+    ALWAYS_INLINE uint32_t getPriority() const {
+        // Traces are recorded only from hot loops and always go first
+        if (isTrace()) {
+            return UINT32_MAX;
+        }
+        // Block already runs tier 1 code, so it waits until interpreted blocks are compiled
+        if (is_optimized) {
+            return 0;
+        }
+        return pending_executions->load(std::memory_order_relaxed);
+    }
 };
 
+struct CompilerStats {
+    std::atomic<size_t> compiled{0};
+    std::atomic<size_t> ahead_of_time{0};
+    // Blocks which replaced tier 1 code by tier 2 one
+    std::atomic<size_t> optimized{0};
+    // Block was evicted before compilation finished, its code waits until the block is fetched again
+    std::atomic<size_t> wasted{0};
+    // Fetched blocks which got code compiled before: ahead of time, by previous run or for the same block evicted
+    std::atomic<size_t> precompiled{0};
+    // Task was dropped from queue since its block had been evicted
+    std::atomic<size_t> cancelled{0};
+    std::atomic<size_t> deduplicated{0};
+    std::atomic<size_t> max_queue_depth{0};
+    // Bytes of compiled code in code cache at its peak
+    std::atomic<size_t> max_code_size{0};
+    // Code evicted from full code cache, its blocks went back to interpreter
+    std::atomic<size_t> evicted{0};
+    // Code released after newer tier or compilation of the same block had replaced it
+    std::atomic<size_t> released{0};
+};
+
+// Workers take the task of the block which was executed most times since it was queued.
+// Priorities change while tasks wait, so they are compared at removal time instead of being kept in a heap
 class CompilerTaskQueue {
 public:
+    CompilerTaskQueue(CompilerStats *stats) : stats_(stats) {}
+
     void addTask(CompilerTask &&task);
     std::optional<CompilerTask> getTask();
+    size_t getDepth();
 
     void close();
     bool isClosed();
 
 private:
-    std::deque<CompilerTask> compiler_tasks_;
+    std::vector<CompilerTask> compiler_tasks_;
+    std::unordered_set<uint64_t> queued_keys_;
     std::condition_variable is_empty_or_closed_;
     std::mutex queue_lock_;
     std::atomic<bool> is_closed_{false};
+    CompilerStats *stats_;
 };
 
+// Pool of compiler threads sharing one task queue
 class CompilerWorker {
 public:
-    CompilerWorker(Compiler *compiler) : compiler_(compiler) {}
+    // Overrides number of compiler threads
+    static constexpr const char *THREADS_COUNT_ENV = "RISCV_JIT_THREADS";
+
+    CompilerWorker(Compiler *compiler, size_t threads_count = getDefaultThreadsCount())
+        : compiler_(compiler), threads_count_(threads_count), task_queue_(&stats_) {
+        ASSERT(threads_count_ > 0);
+    }
+
+    // One hardware thread is left for the hart itself
+    static size_t getDefaultThreadsCount();
+
+    ALWAYS_INLINE size_t getThreadsCount() const {
+        return threads_count_;
+    }
 
     void Initialize();
     void Finalize();
@@ -52,9 +130,19 @@ public:
         task_queue_.addTask(std::move(task));
     }
 
+    ALWAYS_INLINE CompilerStats &getStats() {
+        return stats_;
+    }
+
+    ALWAYS_INLINE size_t getQueueDepth() {
+        return task_queue_.getDepth();
+    }
+
 private:
     Compiler *compiler_;
-    std::thread worker_thread_;
+    size_t threads_count_;
+    std::vector<std::thread> worker_threads_;
+    CompilerStats stats_;
     CompilerTaskQueue task_queue_;
 };
 
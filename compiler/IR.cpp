@@ -0,0 +1,491 @@
+#include "compiler/IR.h"
+
+#include <utility>
+
+namespace RISCV::compiler {
+
+static constexpr uint32_t ALL_REGS = ~1U;
+// RV64 takes 6 lower bits of shift amount, just like x86-64 does
+static constexpr uint64_t SHIFT_MASK = 0x3f;
+static constexpr uint64_t WORD_SHIFT_MASK = 0x1f;
+
+static bool isMulDiv(InstructionType type) {
+    switch (type) {
+        case InstructionType::MUL:
+        case InstructionType::MULH:
+        case InstructionType::MULHSU:
+        case InstructionType::MULHU:
+        case InstructionType::DIV:
+        case InstructionType::DIVU:
+        case InstructionType::REM:
+        case InstructionType::REMU:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Executors of syscalls may change any register
+static bool isSystem(InstructionType type) {
+    return type == InstructionType::ECALL || type == InstructionType::EBREAK;
+}
+
+static bool isPowerOf2(uint64_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static bool isBinaryOp(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::ADD:
+        case IROpcode::SUB:
+        case IROpcode::SHL:
+        case IROpcode::SHR:
+        case IROpcode::SAR:
+        case IROpcode::AND:
+        case IROpcode::OR:
+        case IROpcode::XOR:
+        case IROpcode::SLT:
+        case IROpcode::SLTU:
+        case IROpcode::ADDW:
+        case IROpcode::SUBW:
+        case IROpcode::SHLW:
+        case IROpcode::SHRW:
+        case IROpcode::SARW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static uint64_t signExtendWord(uint32_t value) {
+    return static_cast<int64_t>(static_cast<int32_t>(value));
+}
+
+static uint64_t evaluate(IROpcode opcode, uint64_t lhs, uint64_t rhs) {
+    switch (opcode) {
+        case IROpcode::ADD:
+            return lhs + rhs;
+        case IROpcode::SUB:
+            return lhs - rhs;
+        case IROpcode::SHL:
+            return lhs << (rhs & SHIFT_MASK);
+        case IROpcode::SHR:
+            return lhs >> (rhs & SHIFT_MASK);
+        case IROpcode::SAR:
+            return static_cast<int64_t>(lhs) >> (rhs & SHIFT_MASK);
+        case IROpcode::AND:
+            return lhs & rhs;
+        case IROpcode::OR:
+            return lhs | rhs;
+        case IROpcode::XOR:
+            return lhs ^ rhs;
+        case IROpcode::SLT:
+            return static_cast<int64_t>(lhs) < static_cast<int64_t>(rhs);
+        case IROpcode::SLTU:
+            return lhs < rhs;
+        case IROpcode::ADDW:
+            return signExtendWord(lhs + rhs);
+        case IROpcode::SUBW:
+            return signExtendWord(lhs - rhs);
+        case IROpcode::SHLW:
+            return signExtendWord(static_cast<uint32_t>(lhs) << (rhs & WORD_SHIFT_MASK));
+        case IROpcode::SHRW:
+            return signExtendWord(static_cast<uint32_t>(lhs) >> (rhs & WORD_SHIFT_MASK));
+        case IROpcode::SARW:
+            return signExtendWord(static_cast<int32_t>(lhs) >> (rhs & WORD_SHIFT_MASK));
+        default:
+            UNREACHABLE();
+    }
+}
+
+static void makeConst(IRInstr &instr, uint64_t value) {
+    instr.opcode = IROpcode::CONST;
+    instr.operands = {NO_VALUE, NO_VALUE};
+    instr.imm = value;
+}
+
+static void makeMove(IRInstr &instr, IRValue value) {
+    instr.opcode = IROpcode::MOVE;
+    instr.operands = {value, NO_VALUE};
+}
+
+IRValue IRBlock::append(IRInstr instr) {
+    instrs_.push_back(instr);
+    return instrs_.size() - 1;
+}
+
+IRBlock IRBlock::build(const CompilerTask &task) {
+    IRBlock ir(&task.instrs);
+    ir.instrs_.reserve(task.instrs.size() * 2);
+
+    // Value each guest register holds after the instructions built so far
+    std::array<IRValue, RegisterType::REGISTER_COUNT> regValues;
+    regValues.fill(NO_VALUE);
+
+    auto readReg = [&ir, &regValues](RegisterType reg, uint32_t offset) {
+        if (regValues[reg] == NO_VALUE) {
+            IRInstr instr{reg == RegisterType::ZERO ? IROpcode::CONST : IROpcode::GET_REG};
+            instr.reg = reg;
+            instr.offset = offset;
+            regValues[reg] = ir.append(instr);
+        }
+        return regValues[reg];
+    };
+
+    // Trailing BASIC_BLOCK_END is not translated
+    for (uint32_t offset = 0; offset + 1 < task.instrs.size(); ++offset) {
+        const auto &guest = task.instrs[offset];
+
+        IRInstr instr{IROpcode::GUEST};
+        instr.offset = offset;
+        instr.imm = guest.imm;
+
+        bool hasImm = false;
+        switch (guest.type) {
+            case InstructionType::LUI:
+                instr.opcode = IROpcode::CONST;
+                break;
+            case InstructionType::AUIPC:
+                instr.opcode = IROpcode::CONST;
+                instr.imm = task.getPC(offset) + guest.imm;
+                break;
+            case InstructionType::ADDI:
+                instr.opcode = IROpcode::ADD;
+                hasImm = true;
+                break;
+            case InstructionType::SLLI:
+                instr.opcode = IROpcode::SHL;
+                hasImm = true;
+                break;
+            case InstructionType::SLTI:
+                instr.opcode = IROpcode::SLT;
+                hasImm = true;
+                break;
+            case InstructionType::SLTIU:
+                instr.opcode = IROpcode::SLTU;
+                hasImm = true;
+                break;
+            case InstructionType::XORI:
+                instr.opcode = IROpcode::XOR;
+                hasImm = true;
+                break;
+            case InstructionType::SRLI:
+                instr.opcode = IROpcode::SHR;
+                hasImm = true;
+                break;
+            case InstructionType::SRAI:
+                instr.opcode = IROpcode::SAR;
+                hasImm = true;
+                break;
+            case InstructionType::ORI:
+                instr.opcode = IROpcode::OR;
+                hasImm = true;
+                break;
+            case InstructionType::ANDI:
+                instr.opcode = IROpcode::AND;
+                hasImm = true;
+                break;
+            case InstructionType::ADDIW:
+                instr.opcode = IROpcode::ADDW;
+                hasImm = true;
+                break;
+            case InstructionType::SLLIW:
+                instr.opcode = IROpcode::SHLW;
+                hasImm = true;
+                break;
+            case InstructionType::SRLIW:
+                instr.opcode = IROpcode::SHRW;
+                hasImm = true;
+                break;
+            case InstructionType::SRAIW:
+                instr.opcode = IROpcode::SARW;
+                hasImm = true;
+                break;
+            case InstructionType::ADD:
+                instr.opcode = IROpcode::ADD;
+                break;
+            case InstructionType::SUB:
+                instr.opcode = IROpcode::SUB;
+                break;
+            case InstructionType::SLL:
+                instr.opcode = IROpcode::SHL;
+                break;
+            case InstructionType::SLT:
+                instr.opcode = IROpcode::SLT;
+                break;
+            case InstructionType::SLTU:
+                instr.opcode = IROpcode::SLTU;
+                break;
+            case InstructionType::XOR:
+                instr.opcode = IROpcode::XOR;
+                break;
+            case InstructionType::SRL:
+                instr.opcode = IROpcode::SHR;
+                break;
+            case InstructionType::SRA:
+                instr.opcode = IROpcode::SAR;
+                break;
+            case InstructionType::OR:
+                instr.opcode = IROpcode::OR;
+                break;
+            case InstructionType::AND:
+                instr.opcode = IROpcode::AND;
+                break;
+            case InstructionType::ADDW:
+                instr.opcode = IROpcode::ADDW;
+                break;
+            case InstructionType::SUBW:
+                instr.opcode = IROpcode::SUBW;
+                break;
+            case InstructionType::SLLW:
+                instr.opcode = IROpcode::SHLW;
+                break;
+            case InstructionType::SRLW:
+                instr.opcode = IROpcode::SHRW;
+                break;
+            case InstructionType::SRAW:
+                instr.opcode = IROpcode::SARW;
+                break;
+            default:
+                break;
+        }
+
+        if (instr.opcode == IROpcode::GUEST) {
+            if (isMulDiv(guest.type)) {
+                instr.operands = {readReg(guest.rs1, offset), readReg(guest.rs2, offset)};
+            }
+            ir.append(instr);
+
+            // Result is known only to CodeGenerator from now on
+            if (isSystem(guest.type)) {
+                regValues.fill(NO_VALUE);
+            } else {
+                regValues[guest.rd] = NO_VALUE;
+            }
+            continue;
+        }
+
+        if (isBinaryOp(instr.opcode)) {
+            instr.operands = {readReg(guest.rs1, offset), hasImm ? NO_VALUE : readReg(guest.rs2, offset)};
+        }
+
+        // Value computed for x0 is unused and removed as dead code
+        instr.rd = guest.rd;
+        const IRValue value = ir.append(instr);
+        if (guest.rd != RegisterType::ZERO) {
+            regValues[guest.rd] = value;
+        }
+    }
+
+    return ir;
+}
+
+void IRBlock::optimize() {
+    propagateCopies();
+    foldConstants();
+    reduceStrength();
+    eliminateRedundantLoads();
+    propagateCopies();
+    foldConstants();
+    propagateCopies();
+    eliminateDeadCode();
+}
+
+void IRBlock::propagateCopies() {
+    for (auto &instr : instrs_) {
+        for (auto &operand : instr.operands) {
+            while (operand != NO_VALUE && instrs_[operand].opcode == IROpcode::MOVE) {
+                operand = instrs_[operand].operands[0];
+            }
+        }
+    }
+}
+
+void IRBlock::foldConstants() {
+    for (auto &instr : instrs_) {
+        if (instr.opcode == IROpcode::MOVE) {
+            auto value = getConst(instr.operands[0]);
+            if (value != std::nullopt) {
+                makeConst(instr, *value);
+            }
+            continue;
+        }
+
+        if (instr.opcode == IROpcode::GUEST) {
+            const auto type = (*body_)[instr.offset].type;
+            auto lhs = getConst(instr.operands[0]);
+            auto rhs = getConst(instr.operands[1]);
+            if (isMulDiv(type) && lhs != std::nullopt && rhs != std::nullopt) {
+                instr.rd = (*body_)[instr.offset].rd;
+                makeConst(instr, evaluateMulDiv(type, *lhs, *rhs));
+            }
+            continue;
+        }
+
+        if (!isBinaryOp(instr.opcode)) {
+            continue;
+        }
+
+        auto lhs = getConst(instr.operands[0]);
+        auto rhs = instr.operands[1] == NO_VALUE ? instr.imm : getConst(instr.operands[1]);
+        if (rhs == std::nullopt) {
+            continue;
+        }
+        if (lhs != std::nullopt) {
+            makeConst(instr, evaluate(instr.opcode, *lhs, *rhs));
+            continue;
+        }
+
+        // Operations which leave the first operand as is
+        switch (instr.opcode) {
+            case IROpcode::SHL:
+            case IROpcode::SHR:
+            case IROpcode::SAR:
+                if ((*rhs & SHIFT_MASK) == 0) {
+                    makeMove(instr, instr.operands[0]);
+                }
+                break;
+            case IROpcode::ADD:
+            case IROpcode::SUB:
+            case IROpcode::OR:
+            case IROpcode::XOR:
+                if (*rhs == 0) {
+                    makeMove(instr, instr.operands[0]);
+                }
+                break;
+            case IROpcode::AND:
+                if (*rhs == UINT64_MAX) {
+                    makeMove(instr, instr.operands[0]);
+                } else if (*rhs == 0) {
+                    makeConst(instr, 0);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void IRBlock::reduceStrength() {
+    for (auto &instr : instrs_) {
+        if (instr.opcode != IROpcode::GUEST) {
+            continue;
+        }
+
+        const auto &guest = (*body_)[instr.offset];
+        auto lhs = getConst(instr.operands[0]);
+        auto rhs = getConst(instr.operands[1]);
+
+        // Multiplication commutes
+        if (guest.type == InstructionType::MUL && lhs != std::nullopt && isPowerOf2(*lhs)) {
+            std::swap(instr.operands[0], instr.operands[1]);
+            std::swap(lhs, rhs);
+        }
+        if (rhs == std::nullopt || !isPowerOf2(*rhs)) {
+            continue;
+        }
+
+        const uint64_t shift = __builtin_ctzll(*rhs);
+        switch (guest.type) {
+            case InstructionType::MUL:
+                instr.opcode = IROpcode::SHL;
+                instr.imm = shift;
+                break;
+            case InstructionType::DIVU:
+                instr.opcode = IROpcode::SHR;
+                instr.imm = shift;
+                break;
+            case InstructionType::REMU:
+                instr.opcode = IROpcode::AND;
+                instr.imm = *rhs - 1;
+                break;
+            default:
+                // Signed division rounds towards zero and needs a fixup, native idiv handles it
+                continue;
+        }
+        instr.operands[1] = NO_VALUE;
+        instr.rd = guest.rd;
+    }
+}
+
+void IRBlock::eliminateRedundantLoads() {
+    std::array<IRValue, RegisterType::REGISTER_COUNT> regValues;
+    regValues.fill(NO_VALUE);
+
+    for (IRValue value = 0; value < instrs_.size(); ++value) {
+        auto &instr = instrs_[value];
+        switch (instr.opcode) {
+            case IROpcode::NOP:
+                break;
+            case IROpcode::GET_REG:
+                if (regValues[instr.reg] != NO_VALUE) {
+                    makeMove(instr, regValues[instr.reg]);
+                } else {
+                    regValues[instr.reg] = value;
+                }
+                break;
+            case IROpcode::GUEST: {
+                const auto &guest = (*body_)[instr.offset];
+                if (isSystem(guest.type)) {
+                    regValues.fill(NO_VALUE);
+                } else {
+                    regValues[guest.rd] = NO_VALUE;
+                }
+                break;
+            }
+            default:
+                if (instr.rd != RegisterType::ZERO) {
+                    regValues[instr.rd] = value;
+                }
+                break;
+        }
+    }
+}
+
+void IRBlock::eliminateDeadCode() {
+    // Every register is observed when compiled code is left
+    uint32_t liveRegs = ALL_REGS;
+    std::vector<bool> isUsed(instrs_.size(), false);
+
+    for (size_t idx = instrs_.size(); idx-- > 0;) {
+        auto &instr = instrs_[idx];
+        if (instr.opcode == IROpcode::NOP) {
+            continue;
+        }
+
+        if (instr.opcode == IROpcode::GUEST) {
+            // Multiplication reads only its operands. Everything else may leave the code: loads and stores do it
+            // when their slow path raises an exception, and the hart must see every register as of that instruction
+            const auto &guest = (*body_)[instr.offset];
+            if (isMulDiv(guest.type)) {
+                liveRegs &= ~(1U << guest.rd);
+                liveRegs |= (1U << guest.rs1) | (1U << guest.rs2);
+            } else {
+                liveRegs = ALL_REGS;
+            }
+            continue;
+        }
+
+        const uint32_t rdMask = 1U << instr.rd;
+        if (instr.rd != RegisterType::ZERO && (liveRegs & rdMask) != 0) {
+            liveRegs &= ~rdMask;
+        } else {
+            instr.rd = RegisterType::ZERO;
+            if (!isUsed[idx]) {
+                instr.opcode = IROpcode::NOP;
+                continue;
+            }
+        }
+
+        for (IRValue operand : instr.operands) {
+            if (operand != NO_VALUE) {
+                isUsed[operand] = true;
+            }
+        }
+        if (instr.opcode == IROpcode::GET_REG) {
+            liveRegs |= 1U << instr.reg;
+        }
+    }
+}
+
+}  // namespace RISCV::compiler
@@ -0,0 +1,160 @@
+#ifndef INCLUDE_IR_H_
+#define INCLUDE_IR_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "compiler/CompilerWorker.h"
+#include "simulator/DecodedInstruction.h"
+
+namespace RISCV::compiler {
+
+enum class IROpcode : uint8_t {
+    // Value known at compile time, kept in imm
+    CONST,
+    // Guest register as CodeGenerator holds it at this point
+    GET_REG,
+    // The first operand under another name, only assigns it to guest register
+    MOVE,
+    ADD,
+    SUB,
+    SHL,
+    SHR,
+    SAR,
+    AND,
+    OR,
+    XOR,
+    SLT,
+    SLTU,
+    // RV64 word operations, the result is sign extended from 32 bits
+    ADDW,
+    SUBW,
+    SHLW,
+    SHRW,
+    SARW,
+    // Guest instruction lowered by regular CodeGenerator emitter, it reads and writes guest registers itself
+    GUEST,
+    // Removed by optimization
+    NOP,
+};
+
+static inline bool isWordOp(IROpcode opcode) {
+    return opcode >= IROpcode::ADDW && opcode <= IROpcode::SARW;
+}
+
+static inline bool isShiftOp(IROpcode opcode) {
+    switch (opcode) {
+        case IROpcode::SHL:
+        case IROpcode::SHR:
+        case IROpcode::SAR:
+        case IROpcode::SHLW:
+        case IROpcode::SHRW:
+        case IROpcode::SARW:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Division by zero and overflow give the results defined by the M extension instead of trapping
+static inline uint64_t evaluateMulDiv(InstructionType type, uint64_t lhs, uint64_t rhs) {
+    const auto signedLhs = static_cast<int64_t>(lhs);
+    const auto signedRhs = static_cast<int64_t>(rhs);
+    const bool isOverflow = signedLhs == INT64_MIN && signedRhs == -1;
+
+    switch (type) {
+        case InstructionType::MUL:
+            return lhs * rhs;
+        case InstructionType::MULH:
+            return static_cast<__int128>(signedLhs) * signedRhs >> 64;
+        case InstructionType::MULHSU:
+            return static_cast<__int128>(signedLhs) * static_cast<__int128>(rhs) >> 64;
+        case InstructionType::MULHU:
+            return static_cast<unsigned __int128>(lhs) * rhs >> 64;
+        case InstructionType::DIV:
+            if (rhs == 0) {
+                return UINT64_MAX;
+            }
+            return isOverflow ? lhs : signedLhs / signedRhs;
+        case InstructionType::DIVU:
+            return rhs == 0 ? UINT64_MAX : lhs / rhs;
+        case InstructionType::REM:
+            if (rhs == 0) {
+                return lhs;
+            }
+            return isOverflow ? 0 : signedLhs % signedRhs;
+        case InstructionType::REMU:
+            return rhs == 0 ? lhs : lhs % rhs;
+        default:
+            UNREACHABLE();
+    }
+}
+
+// Every instruction defines at most one value, which is named by index of the instruction
+using IRValue = uint32_t;
+static constexpr IRValue NO_VALUE = UINT32_MAX;
+
+struct IRInstr {
+    IROpcode opcode;
+    // Guest register the result is written to, ZERO if it is only used by other instructions
+    RegisterType rd = RegisterType::ZERO;
+    // Register read by GET_REG
+    RegisterType reg = RegisterType::ZERO;
+    // Binary operations take imm instead of the second operand if it is NO_VALUE.
+    // GUEST multiplication and division keep their operands here only for constant folding and strength reduction
+    std::array<IRValue, 2> operands{NO_VALUE, NO_VALUE};
+    uint64_t imm = 0;
+    // Index of guest instruction in compiled body
+    uint32_t offset = 0;
+};
+
+// SSA form of straight-line code of a block or trace, used by tier 2.
+// Guest registers are read once, ALU instructions become operations over values and everything else stays a GUEST
+// instruction which bounds the analysis
+class IRBlock {
+public:
+    static IRBlock build(const CompilerTask &task);
+
+    void optimize();
+
+    ALWAYS_INLINE const std::vector<IRInstr> &getInstrs() const {
+        return instrs_;
+    }
+
+    ALWAYS_INLINE const IRInstr &getInstr(IRValue value) const {
+        return instrs_[value];
+    }
+
+    ALWAYS_INLINE std::optional<uint64_t> getConst(IRValue value) const {
+        if (value == NO_VALUE || instrs_[value].opcode != IROpcode::CONST) {
+            return std::nullopt;
+        }
+        return instrs_[value].imm;
+    }
+
+private:
+    IRBlock(const BasicBlock::Body *body) : body_(body) {}
+
+    IRValue append(IRInstr instr);
+
+    // Operands of MOVE are used directly
+    void propagateCopies();
+    // Operations over constants are evaluated, LUI + ADDI pairs become a single constant
+    void foldConstants();
+    // Multiplication and unsigned division by power of two become shifts and masks
+    void reduceStrength();
+    // Register read after GUEST instruction which did not change it reuses the value known before
+    void eliminateRedundantLoads();
+    // Writes to guest registers overwritten before anyone observes them are dropped, so are unused values.
+    // Writes to x0 are never created in the first place
+    void eliminateDeadCode();
+
+    const BasicBlock::Body *body_;
+    std::vector<IRInstr> instrs_;
+};
+
+}  // namespace RISCV::compiler
+
+#endif  // INCLUDE_IR_H_
@@ -0,0 +1,210 @@
+#include "compiler/PersistentCache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace RISCV::compiler {
+
+static std::string getCacheDir() {
+    const char *dir = std::getenv(PersistentCache::DIR_ENV);
+    if (dir != nullptr) {
+        return dir;
+    }
+
+    const char *home = std::getenv("HOME");
+    if (home == nullptr) {
+        return {};
+    }
+    return std::string(home) + "/.cache/riscv-jit";
+}
+
+static size_t alignCode(size_t size, size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+PersistentCache::~PersistentCache() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+
+    const int fd = fd_.load(std::memory_order_relaxed);
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+uint64_t PersistentCache::hash(const void *data, size_t size, uint64_t seed) {
+    constexpr uint64_t prime = 0x100000001b3ULL;
+
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        seed ^= bytes[i];
+        seed *= prime;
+    }
+    return seed;
+}
+
+uint64_t PersistentCache::getBuildId() {
+    // Code layout depends on the emulator build, so any rebuild starts with the new cache file
+    struct stat exeStat {};
+    if (stat("/proc/self/exe", &exeStat) == -1) {
+        return 0;
+    }
+
+    uint64_t buildId = hash(&exeStat.st_size, sizeof(exeStat.st_size));
+    buildId = hash(&exeStat.st_mtime, sizeof(exeStat.st_mtime), buildId);
+    buildId = hash(&exeStat.st_ino, sizeof(exeStat.st_ino), buildId);
+    return buildId;
+}
+
+uint32_t PersistentCache::getChecksum(BasicBlock::Entrypoint entrypoint, const void *code, size_t size) {
+    return hash(code, size, hash(&entrypoint, sizeof(entrypoint)));
+}
+
+void PersistentCache::open(uint64_t program_hash) {
+    ASSERT(fd_.load(std::memory_order_relaxed) == -1);
+
+    const std::string dir = getCacheDir();
+    const uint64_t buildId = getBuildId();
+    if (dir.empty() || buildId == 0) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        return;
+    }
+
+    // Build id is a part of file name, so files are never rewritten while another run maps them
+    char name[64];
+    snprintf(name, sizeof(name), "/%016" PRIx64 "-%016" PRIx64 ".jit", program_hash, buildId);
+    const std::string path = dir + name;
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return;
+    }
+
+    const FileHeader expectedHeader{MAGIC, buildId, program_hash, 0};
+
+    flock(fd, LOCK_EX);
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) == -1) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return;
+    }
+
+    size_t fileSize = fileStat.st_size;
+    if (fileSize == 0) {
+        if (write(fd, &expectedHeader, sizeof(expectedHeader)) != sizeof(expectedHeader)) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return;
+        }
+        fileSize = sizeof(expectedHeader);
+    }
+    flock(fd, LOCK_UN);
+
+    FileHeader header{};
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        std::memcmp(&header, &expectedHeader, sizeof(header)) != 0) {
+        // Broken file is left as is, this run just does not use it
+        close(fd);
+        return;
+    }
+
+    if (fileSize > sizeof(FileHeader)) {
+        void *mapping = mmap(nullptr, fileSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            mapping_ = mapping;
+            mapping_size_ = fileSize;
+            loadRecords(fileSize);
+        }
+    }
+
+    fd_.store(fd, std::memory_order_release);
+}
+
+void PersistentCache::loadRecords(size_t file_size) {
+    auto base = static_cast<const uint8_t *>(mapping_);
+
+    size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= file_size) {
+        RecordHeader record;
+        std::memcpy(&record, base + offset, sizeof(record));
+
+        const size_t recordSize = sizeof(RecordHeader) + alignCode(record.code_size, CODE_ALIGNMENT);
+        if (record.code_size == 0 || offset + recordSize > file_size) {
+            break;
+        }
+
+        const uint8_t *code = base + offset + sizeof(RecordHeader);
+        // Everything after torn record is misaligned
+        if (getChecksum(record.entrypoint, code, record.code_size) != record.checksum) {
+            break;
+        }
+
+        entries_.emplace(record.entrypoint, reinterpret_cast<CompiledEntry>(const_cast<uint8_t *>(code)));
+        code_sizes_.emplace(reinterpret_cast<uintptr_t>(code), record.code_size);
+        offset += recordSize;
+    }
+}
+
+PersistentCache::CompiledEntry PersistentCache::find(BasicBlock::Entrypoint entrypoint) const {
+    auto entry = entries_.find(entrypoint);
+    if (entry == entries_.end()) {
+        return nullptr;
+    }
+    return entry->second;
+}
+
+std::optional<CodeRange> PersistentCache::findCode(const void *address) const {
+    auto code = code_sizes_.upper_bound(reinterpret_cast<uintptr_t>(address));
+    if (code == code_sizes_.begin()) {
+        return std::nullopt;
+    }
+    --code;
+    const auto *start = reinterpret_cast<const uint8_t *>(code->first);
+    if (static_cast<const uint8_t *>(address) >= start + code->second) {
+        return std::nullopt;
+    }
+    return CodeRange{start, code->second};
+}
+
+void PersistentCache::store(BasicBlock::Entrypoint entrypoint, const void *code, size_t size) {
+    const int fd = fd_.load(std::memory_order_acquire);
+    if (fd == -1 || size == 0) {
+        return;
+    }
+
+    {
+        // entries_ is filled by open only, so workers may read it
+        std::lock_guard holder(lock_);
+        if (entries_.count(entrypoint) != 0 || !stored_.insert(entrypoint).second) {
+            return;
+        }
+    }
+
+    std::vector<uint8_t> record(sizeof(RecordHeader) + alignCode(size, CODE_ALIGNMENT));
+    const RecordHeader header{entrypoint, static_cast<uint32_t>(size), getChecksum(entrypoint, code, size)};
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), code, size);
+
+    // Single append keeps records of concurrent workers and processes apart, failed write only loses this block
+    [[maybe_unused]] ssize_t written = write(fd, record.data(), record.size());
+}
+
+}  // namespace RISCV::compiler
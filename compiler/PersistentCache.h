@@ -0,0 +1,88 @@
+#ifndef INCLUDE_PERSISTENT_CACHE_H_
+#define INCLUDE_PERSISTENT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "compiler/SideTable.h"
+
+#include "simulator/BasicBlock.h"
+#include "utils/macros.h"
+
+namespace RISCV::compiler {
+
+// Compiled code of basic blocks saved between runs of the same program.
+// Translations are appended to a file named after hash of the program text and the emulator binary. On the next run
+// the file is mapped as executable and blocks are installed right after fetch, without interpretation
+class PersistentCache {
+public:
+    using CompiledEntry = BasicBlock::CompiledEntry;
+
+    // Directory with cache files, $HOME/.cache/riscv-jit by default. Empty value disables the cache
+    static constexpr const char *DIR_ENV = "RISCV_JIT_CACHE_DIR";
+    static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+
+    PersistentCache() = default;
+    ~PersistentCache();
+    NO_COPY_SEMANTIC(PersistentCache);
+    NO_MOVE_SEMANTIC(PersistentCache);
+
+    // FNV-1a, chained through seed
+    static uint64_t hash(const void *data, size_t size, uint64_t seed = HASH_SEED);
+
+    void open(uint64_t program_hash);
+
+    // Returns nullptr if block was not compiled by previous runs
+    CompiledEntry find(BasicBlock::Entrypoint entrypoint) const;
+
+    // Mapped code the address belongs to
+    std::optional<CodeRange> findCode(const void *address) const;
+
+    // Called by compiler workers, code must not contain absolute addresses. Block recompiled after eviction from code
+    // cache is not saved again
+    void store(BasicBlock::Entrypoint entrypoint, const void *code, size_t size);
+
+private:
+    static constexpr uint64_t MAGIC = 0x5449'4a56'4353'4952ULL;
+    static constexpr size_t CODE_ALIGNMENT = 16;
+
+    struct FileHeader {
+        uint64_t magic;
+        uint64_t build_id;
+        uint64_t program_hash;
+        uint64_t reserved;
+    };
+
+    // Followed by code padded to CODE_ALIGNMENT
+    struct RecordHeader {
+        uint64_t entrypoint;
+        uint32_t code_size;
+        // Records torn by crashed writer are detected by it
+        uint32_t checksum;
+    };
+
+    static uint64_t getBuildId();
+    static uint32_t getChecksum(BasicBlock::Entrypoint entrypoint, const void *code, size_t size);
+
+    void loadRecords(size_t file_size);
+
+    std::atomic<int> fd_{-1};
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::unordered_map<BasicBlock::Entrypoint, CompiledEntry> entries_;
+    // Sizes of mapped code by its address
+    std::map<uintptr_t, size_t> code_sizes_;
+
+    std::mutex lock_;
+    // Entrypoints saved by this run, loaded ones are in entries_
+    std::unordered_set<BasicBlock::Entrypoint> stored_;
+};
+
+}  // namespace RISCV::compiler
+
+#endif  // INCLUDE_PERSISTENT_CACHE_H_
@@ -0,0 +1,87 @@
+#include "compiler/RuntimeHelpers.h"
+
+#include "simulator/Dispatcher.h"
+#include "simulator/Hart.h"
+
+namespace RISCV::compiler {
+
+// Compiled code does not store PC before calling slow paths, hart restores it by their return address on exception
+template <typename T>
+static RegValue ExecutorLoadSlowPath(Hart *hart, memory::VirtAddr vaddr) {
+    hart->enterSlowPath(__builtin_return_address(0));
+    T loaded;
+
+    if (UNLIKELY(vaddr % sizeof(loaded))) {
+        hart->restoreGuestState();
+        std::cerr << "Error: unaligned memory access at pc 0x" << std::hex << hart->getPC() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::RMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.read(paddr, sizeof(loaded), &loaded);
+
+    hart->leaveSlowPath();
+    // Signed types are sign extended by the conversion
+    return loaded;
+}
+
+template <typename T>
+static void ExecutorStoreSlowPath(Hart *hart, memory::VirtAddr vaddr, RegValue value) {
+    hart->enterSlowPath(__builtin_return_address(0));
+    T stored = value;
+
+    if (UNLIKELY(vaddr % sizeof(stored))) {
+        hart->restoreGuestState();
+        std::cerr << "Error: unaligned memory access at pc 0x" << std::hex << hart->getPC() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::WMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.write(paddr, sizeof(stored), &stored);
+    hart->leaveSlowPath();
+}
+
+static void ExecutorTierUp(Hart *hart, BasicBlock *bb) {
+    hart->optimizeBasicBlock(*bb);
+}
+
+static void ExecutorExecuteBlock(Hart *hart, BasicBlock *bb) {
+    hart->executeBasicBlock(*bb);
+}
+
+static RuntimeHelpers makeRuntimeHelpers() {
+    RuntimeHelpers helpers{};
+
+    for (size_t type = 0; type < InstructionType::INSTRUCTION_COUNT; ++type) {
+        helpers.executors[type] = Dispatcher::getExecutor(static_cast<InstructionType>(type));
+    }
+
+    auto &slowPaths = helpers.memory_slow_paths;
+    slowPaths[InstructionType::LB] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<int8_t>);
+    slowPaths[InstructionType::LH] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<int16_t>);
+    slowPaths[InstructionType::LW] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<int32_t>);
+    slowPaths[InstructionType::LD] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<uint64_t>);
+    slowPaths[InstructionType::LBU] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<uint8_t>);
+    slowPaths[InstructionType::LHU] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<uint16_t>);
+    slowPaths[InstructionType::LWU] = reinterpret_cast<const void *>(&ExecutorLoadSlowPath<uint32_t>);
+    slowPaths[InstructionType::SB] = reinterpret_cast<const void *>(&ExecutorStoreSlowPath<uint8_t>);
+    slowPaths[InstructionType::SH] = reinterpret_cast<const void *>(&ExecutorStoreSlowPath<uint16_t>);
+    slowPaths[InstructionType::SW] = reinterpret_cast<const void *>(&ExecutorStoreSlowPath<uint32_t>);
+    slowPaths[InstructionType::SD] = reinterpret_cast<const void *>(&ExecutorStoreSlowPath<uint64_t>);
+
+    helpers.tier_up = reinterpret_cast<const void *>(&ExecutorTierUp);
+    helpers.execute_block = reinterpret_cast<const void *>(&ExecutorExecuteBlock);
+
+    return helpers;
+}
+
+const RuntimeHelpers &getRuntimeHelpers() {
+    static const RuntimeHelpers helpers = makeRuntimeHelpers();
+    return helpers;
+}
+
+}  // namespace RISCV::compiler
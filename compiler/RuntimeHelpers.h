@@ -0,0 +1,28 @@
+#ifndef INCLUDE_RUNTIME_HELPERS_H_
+#define INCLUDE_RUNTIME_HELPERS_H_
+
+#include <array>
+
+#include "generated/InstructionTypes.h"
+#include "simulator/Executor.h"
+
+namespace RISCV::compiler {
+
+// Compiled code calls into emulator only through this table, which is reachable from Hart.
+// So generated code does not depend on addresses the emulator is loaded at and can be reused by the next run
+struct RuntimeHelpers {
+    // Indexed by InstructionType
+    std::array<Executor, InstructionType::INSTRUCTION_COUNT> executors;
+    // Indexed by InstructionType of load or store, used on TLB miss and misaligned access
+    std::array<const void *, InstructionType::INSTRUCTION_COUNT> memory_slow_paths;
+    // Called by tier 1 code once its block becomes hot enough, signature is void(Hart *, BasicBlock *)
+    const void *tier_up;
+    // Called by dispatcher for block runtime has to execute itself, signature is void(Hart *, BasicBlock *)
+    const void *execute_block;
+};
+
+const RuntimeHelpers &getRuntimeHelpers();
+
+}  // namespace RISCV::compiler
+
+#endif  // INCLUDE_RUNTIME_HELPERS_H_
@@ -0,0 +1,52 @@
+#ifndef INCLUDE_SIDE_TABLE_H_
+#define INCLUDE_SIDE_TABLE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+namespace RISCV::compiler {
+
+// Start and size of compiled code
+using CodeRange = std::pair<const uint8_t *, size_t>;
+
+// Guest state at call of runtime slow path. Compiled code does not store PC before such calls, runtime restores it
+// by return address of the call when slow path raises an exception. Registers held by host ones are written back
+// before the call, and tier 2 dead store elimination keeps every register write that precedes a slow path, so hart
+// registers match the faulting instruction.
+// Table ends compiled code, which keeps it relocatable and saved together with the code:
+//     SafePoint[count], uint64_t count
+struct SafePoint {
+    // Return address lies in (begin, end], both are offsets from the start of the code
+    uint32_t begin;
+    uint32_t end;
+    uint64_t pc;
+};
+
+static inline std::optional<uint64_t> findSafePointPC(const CodeRange &code, const void *return_address) {
+    const auto [start, size] = code;
+    uint64_t count = 0;
+    if (size < sizeof(count)) {
+        return std::nullopt;
+    }
+    std::memcpy(&count, start + size - sizeof(count), sizeof(count));
+    if (count > (size - sizeof(count)) / sizeof(SafePoint)) {
+        return std::nullopt;
+    }
+
+    const uint8_t *table = start + size - sizeof(count) - count * sizeof(SafePoint);
+    const uint64_t offset = static_cast<const uint8_t *>(return_address) - start;
+    for (uint64_t i = 0; i < count; ++i) {
+        SafePoint safe_point;
+        std::memcpy(&safe_point, table + i * sizeof(SafePoint), sizeof(SafePoint));
+        if (safe_point.begin < offset && offset <= safe_point.end) {
+            return safe_point.pc;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace RISCV::compiler
+
+#endif  // INCLUDE_SIDE_TABLE_H_
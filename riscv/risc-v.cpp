@@ -60,11 +60,8 @@ int main(int argc, char **argv, char **envp) {
     auto executeStart = std::chrono::high_resolution_clock::now();
 
     // Main simulation loop
-    while (CPU.getPC() != 0) {
-        auto& bb = CPU.getBasicBlock();
-        CPU.executeBasicBlock(bb);
-        instrCount += bb.getSize();
-    }
+    CPU.run();
+    instrCount = CPU.getInstrCount();
 
     auto executeEnd = std::chrono::high_resolution_clock::now() - executeStart;
     uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(executeEnd).count();
@@ -82,6 +79,19 @@ int main(int argc, char **argv, char **envp) {
     std::cout << "Simulated instruction count: " << instrCount << std::endl;
     std::cout << "Average MIPS:                " << static_cast<float>(instrCount) / microseconds << std::endl;
 
+    auto &compilerStats = CPU.getCompilerStats();
+    std::cout << "Compiled blocks and traces:  " << compilerStats.compiled << std::endl;
+    std::cout << "Compiled ahead of time:      " << compilerStats.ahead_of_time << std::endl;
+    std::cout << "Optimized by tier 2:         " << compilerStats.optimized << std::endl;
+    std::cout << "Wasted compilations:         " << compilerStats.wasted << std::endl;
+    std::cout << "Installed precompiled code:  " << compilerStats.precompiled << std::endl;
+    std::cout << "Cancelled compilations:      " << compilerStats.cancelled << std::endl;
+    std::cout << "Deduplicated compilations:   " << compilerStats.deduplicated << std::endl;
+    std::cout << "Max compile queue depth:     " << compilerStats.max_queue_depth << std::endl;
+    std::cout << "Peak compiled code size:     " << compilerStats.max_code_size << std::endl;
+    std::cout << "Evicted compiled code:       " << compilerStats.evicted << std::endl;
+    std::cout << "Released replaced code:      " << compilerStats.released << std::endl;
+
     if (fd_instr != -1) {
         std::cout << "Executed host instructions:  " << hostInstructions << std::endl;
         std::cout << "Average host per simulated:  " << static_cast<float>(hostInstructions) / instrCount << std::endl;
@@ -0,0 +1,161 @@
+#include "simulator/BasicBlock.h"
+
+namespace RISCV {
+
+// PC stays behind by size of dropped NOPs until BASIC_BLOCK_END adds it back. Relative jumps and branches land
+// behind by the same size as well, while absolute targets, values computed from PC and PC reported by a faulting
+// memory access would be wrong
+static bool toleratesPCLag(const DecodedInstruction &instr) {
+    switch (getOriginalInstruction(instr.type)) {
+        case InstructionType::AUIPC:
+        case InstructionType::JALR:
+        case InstructionType::ECALL:
+        case InstructionType::LB:
+        case InstructionType::LH:
+        case InstructionType::LW:
+        case InstructionType::LD:
+        case InstructionType::LBU:
+        case InstructionType::LHU:
+        case InstructionType::LWU:
+        case InstructionType::SB:
+        case InstructionType::SH:
+        case InstructionType::SW:
+        case InstructionType::SD:
+            return false;
+        case InstructionType::JAL:
+            return instr.rd == RegisterType::ZERO;
+        default:
+            return true;
+    }
+}
+
+// NOPs followed only by instructions tolerating PC lag are removed, the last instruction is always kept
+static BasicBlock::DroppedNops dropNops(BasicBlock::Body &body) {
+    size_t first_droppable = body.size();
+    while (first_droppable > 0 && toleratesPCLag(body[first_droppable - 1])) {
+        --first_droppable;
+    }
+
+    BasicBlock::DroppedNops dropped_nops = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (i >= first_droppable && i + 1 < body.size() && body[i].type == InstructionType::NOP) {
+            dropped_nops |= 1U << i;
+            continue;
+        }
+        body[kept++] = body[i];
+    }
+    body.resize(kept);
+    return dropped_nops;
+}
+
+// Adjacent instructions compilers emit together are interpreted by a single handler. Specialized instructions are
+// fused as the original ones, fused handler executes them the general way
+static void fuseSuperinstructions(BasicBlock::Body &body) {
+    for (size_t i = 0; i + 1 < body.size(); ++i) {
+        const InstructionType fused =
+            getSuperinstruction(getOriginalInstruction(body[i].type), getOriginalInstruction(body[i + 1].type));
+        if (fused != InstructionType::INSTRUCTION_INVALID) {
+            body[i].type = fused;
+            // The second instruction can not start another pair
+            ++i;
+        }
+    }
+}
+
+void BasicBlock::link(BasicBlock **slot) {
+    ASSERT(getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILED);
+    // Slots pointing to the block are registered already
+    if (*slot == this) {
+        return;
+    }
+    *slot = this;
+    predecessors_.push_back(slot);
+}
+
+void BasicBlock::linkIndirect(BasicBlock &target) {
+    // Entry of the target could be unlinked by its eviction, then it is reused
+    IndirectLink *indirect_link = nullptr;
+    for (auto &candidate : indirect_links_) {
+        if (candidate.bb == nullptr || candidate.target == target.getEntrypoint()) {
+            indirect_link = &candidate;
+            break;
+        }
+    }
+    if (indirect_link == nullptr) {
+        indirect_link = &indirect_links_[next_indirect_link_];
+        next_indirect_link_ = (next_indirect_link_ + 1) % INDIRECT_LINK_COUNT;
+    }
+
+    // Otherwise the old target keeps the slot and its list grows with every miss of a jump rotating through targets
+    if (indirect_link->bb != nullptr) {
+        indirect_link->bb->forgetPredecessor(&indirect_link->bb);
+    }
+    indirect_link->target = target.getEntrypoint();
+    target.link(&indirect_link->bb);
+}
+
+void BasicBlock::unlinkPredecessors() {
+    for (BasicBlock **slot : predecessors_) {
+        // Slot owner could be evicted and relinked to another block meanwhile
+        if (*slot == this) {
+            *slot = nullptr;
+        }
+    }
+    predecessors_.clear();
+}
+
+void BasicBlock::forgetPredecessor(BasicBlock **slot) {
+    auto predecessor = std::find(predecessors_.begin(), predecessors_.end(), slot);
+    if (predecessor != predecessors_.end()) {
+        *predecessor = predecessors_.back();
+        predecessors_.pop_back();
+    }
+}
+
+void BasicBlock::resetCompiledCode() {
+    unlinkPredecessors();
+    compiled_entry_.store(nullptr, std::memory_order_relaxed);
+    compilation_status_.store(CompilationStatus::NOT_COMPILED, std::memory_order_relaxed);
+    pending_executions_.reset();
+    hotness_counter_ = START_HOTNESS_COUNTER;
+    tier_up_counter_ = TIER_UP_HOTNESS_COUNTER;
+}
+
+size_t BasicBlock::getOffsetToEntrypoint() {
+    return MEMBER_OFFSET(BasicBlock, entrypoint_);
+}
+
+size_t BasicBlock::getOffsetToCompiledEntry() {
+    return MEMBER_OFFSET(BasicBlock, compiled_entry_);
+}
+
+size_t BasicBlock::getOffsetToCompilationStatus() {
+    return MEMBER_OFFSET(BasicBlock, compilation_status_);
+}
+
+size_t BasicBlock::getOffsetToHasTrace() {
+    return MEMBER_OFFSET(BasicBlock, has_trace_);
+}
+
+size_t BasicBlock::getOffsetToLinks() {
+    return MEMBER_OFFSET(BasicBlock, links_);
+}
+
+size_t BasicBlock::getOffsetToIndirectLinks() {
+    return MEMBER_OFFSET(BasicBlock, indirect_links_);
+}
+
+size_t BasicBlock::getOffsetToTierUpCounter() {
+    return MEMBER_OFFSET(BasicBlock, tier_up_counter_);
+}
+
+BasicBlock::DroppedNops BasicBlock::prepareBody(Body &body) {
+    const DroppedNops dropped_nops = dropNops(body);
+    fuseSuperinstructions(body);
+    auto &end = body.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+    end.imm = INSTRUCTION_BYTESIZE * __builtin_popcount(dropped_nops);
+    return dropped_nops;
+}
+
+}  // namespace RISCV
@@ -1,7 +1,10 @@
 #ifndef INCLUDE_BASIC_BLOCK_H
 #define INCLUDE_BASIC_BLOCK_H
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <memory>
 #include <vector>
 
 #include "simulator/DecodedInstruction.h"
@@ -15,64 +18,151 @@ enum class CompilationStatus : uint8_t { NOT_COMPILED, COMPILING, COMPILED };
 
 class BasicBlock {
 public:
+    // Bodies are passed around as vectors, but stored inline by blocks
     using Body = std::vector<DecodedInstruction>;
-    using BodyEntry = Body::const_iterator;
+    using BodyEntry = const DecodedInstruction *;
     using Entrypoint = uint64_t;
-    using CompiledEntry = void (*)(Hart *, const DecodedInstruction *);
+    using PendingExecutions = std::shared_ptr<std::atomic<uint32_t>>;
+    // Compiled code returns linked successor or nullptr if control must go back to runtime.
+    // It does not refer to the body, so the same code serves the block fetched again after eviction
+    using CompiledEntry = BasicBlock *(*)(Hart *, BasicBlock *);
 
     // Fastest
     static constexpr size_t MAX_SIZE = 9;
     static constexpr uint32_t START_HOTNESS_COUNTER = 10;
+    // Number of backward jumps into block after which the path starting from it is recorded as a trace
+    static constexpr uint32_t TRACE_START_HOTNESS_COUNTER = 50;
+    // Executions of tier 1 code after which the block is recompiled with optimizations
+    static constexpr uint32_t TIER_UP_HOTNESS_COUNTER = 1000;
 
-    BasicBlock(Body body, Entrypoint entrypoint) : body_(std::move(body)), entrypoint_(entrypoint) {
-        ASSERT(body_.back().type == BASIC_BLOCK_END);
+    // Exits of compiled code which can be chained directly to successor
+    enum LinkIndex : uint8_t { TAKEN_LINK, FALLTHROUGH_LINK, LINK_COUNT };
+
+    // Inline cache of indirect jump ending the block, compiled code looks for jump target there before returning to
+    // runtime. Entry tells where the target lives whichever block holds it, so stale entries are harmless
+    struct IndirectLink {
+        Entrypoint target;
+        BasicBlock *bb;
+    };
+    static constexpr size_t INDIRECT_LINK_COUNT = 2;
+
+    // Body of block with BASIC_BLOCK_END
+    static constexpr size_t INLINE_BODY_CAPACITY = MAX_SIZE + 1;
+
+    // Bit i is set if i-th fetched instruction is a NOP missing from the body
+    using DroppedNops = uint16_t;
+    static_assert(MAX_SIZE <= sizeof(DroppedNops) * 8);
+
+    // Turns fetched instructions into body of block: drops NOPs, fuses superinstructions and appends
+    // BASIC_BLOCK_END. Returns the dropped NOPs
+    static DroppedNops prepareBody(Body &body);
+
+    BasicBlock(Body body, Entrypoint entrypoint, DroppedNops dropped_nops = 0)
+        : dropped_nops_(dropped_nops), entrypoint_(entrypoint) {
+        ASSERT(body.back().type == BASIC_BLOCK_END);
+        ASSERT(body.back().imm == static_cast<int32_t>(INSTRUCTION_BYTESIZE * __builtin_popcount(dropped_nops)));
+        setBody(std::move(body));
     }
 
+    // Links are bound to address of the block, so they are never transferred
     BasicBlock(const BasicBlock &bb)
-        : body_(bb.body_),
+        : inline_body_(bb.inline_body_),
+          long_body_(bb.long_body_),
+          body_size_(bb.body_size_),
+          dropped_nops_(bb.dropped_nops_),
           entrypoint_(bb.entrypoint_),
           hotness_counter_(bb.hotness_counter_),
-          compiled_entry_(bb.compiled_entry_),
-          compilation_status_(bb.compilation_status_.load(std::memory_order_relaxed)) {}
+          trace_hotness_counter_(bb.trace_hotness_counter_),
+          is_trace_(bb.is_trace_),
+          tier_up_counter_(bb.tier_up_counter_),
+          compiled_entry_(bb.compiled_entry_.load(std::memory_order_relaxed)),
+          compilation_status_(bb.compilation_status_.load(std::memory_order_relaxed)),
+          pending_executions_(bb.pending_executions_),
+          has_trace_(bb.has_trace_.load(std::memory_order_relaxed)) {}
 
     BasicBlock(BasicBlock &&bb)
-        : body_(std::move(bb.body_)),
+        : inline_body_(bb.inline_body_),
+          long_body_(std::move(bb.long_body_)),
+          body_size_(bb.body_size_),
+          dropped_nops_(bb.dropped_nops_),
           entrypoint_(bb.entrypoint_),
           hotness_counter_(bb.hotness_counter_),
-          compiled_entry_(bb.compiled_entry_),
-          compilation_status_(bb.compilation_status_.load(std::memory_order_relaxed)) {}
+          trace_hotness_counter_(bb.trace_hotness_counter_),
+          is_trace_(bb.is_trace_),
+          tier_up_counter_(bb.tier_up_counter_),
+          compiled_entry_(bb.compiled_entry_.load(std::memory_order_relaxed)),
+          compilation_status_(bb.compilation_status_.load(std::memory_order_relaxed)),
+          pending_executions_(std::move(bb.pending_executions_)),
+          has_trace_(bb.has_trace_.load(std::memory_order_relaxed)) {}
 
     BasicBlock() = default;
 
     ~BasicBlock() = default;
 
     BasicBlock &operator=(BasicBlock &&bb) {
-        body_ = std::move(bb.body_);
+        inline_body_ = bb.inline_body_;
+        long_body_ = std::move(bb.long_body_);
+        body_size_ = bb.body_size_;
+        dropped_nops_ = bb.dropped_nops_;
         entrypoint_ = std::move(bb.entrypoint_);
         hotness_counter_ = std::move(bb.hotness_counter_);
-        compiled_entry_ = std::move(bb.compiled_entry_);
+        trace_hotness_counter_ = std::move(bb.trace_hotness_counter_);
+        is_trace_ = std::move(bb.is_trace_);
+        tier_up_counter_ = std::move(bb.tier_up_counter_);
+        compiled_entry_ = std::move(bb.compiled_entry_.load(std::memory_order_relaxed));
         compilation_status_ = std::move(bb.compilation_status_.load(std::memory_order_relaxed));
+        pending_executions_ = std::move(bb.pending_executions_);
+        has_trace_ = std::move(bb.has_trace_.load(std::memory_order_relaxed));
+        links_ = {};
+        indirect_links_ = {};
+        next_indirect_link_ = 0;
+        predecessors_.clear();
         return *this;
     }
 
     ALWAYS_INLINE size_t getSize() const {
-        return body_.size();
+        return body_size_;
+    }
+
+    // Guest instructions the block consists of, including dropped NOPs. Sentinel BASIC_BLOCK_END is not counted
+    ALWAYS_INLINE size_t getInstrCount() const {
+        return body_size_ - 1 + __builtin_popcount(dropped_nops_);
     }
 
     ALWAYS_INLINE BodyEntry getBodyEntry() const {
-        return body_.cbegin();
+        return long_body_.empty() ? inline_body_.data() : long_body_.data();
     }
 
+    // NOP is never dropped from the end of the block
+    ALWAYS_INLINE const DecodedInstruction &getLastInstr() const {
+        return getBodyEntry()[body_size_ - 2];
+    }
+
+    // Superinstructions are split back, specialized instructions get their original type and dropped NOPs take their
+    // places again, so compiler sees instructions as they are in guest memory
     ALWAYS_INLINE Body getBody() const {
-        return body_;
+        Body body;
+        body.reserve(getInstrCount() + 1);
+        BodyEntry instr = getBodyEntry();
+        for (size_t i = 0; i < getInstrCount(); ++i) {
+            if (dropped_nops_ & (1U << i)) {
+                auto &nop = body.emplace_back(DecodedInstruction{.type = InstructionType::ADDI});
+                nop.rd = nop.rs1 = RegisterType::ZERO;
+                continue;
+            }
+            body.push_back(*instr++);
+            body.back().type = getOriginalInstruction(body.back().type);
+        }
+        body.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+        return body;
     }
 
     ALWAYS_INLINE Entrypoint getEntrypoint() const {
         return entrypoint_;
     }
 
-    ALWAYS_INLINE void executeCompiled(Hart *hart) const {
-        compiled_entry_(hart, body_.data());
+    ALWAYS_INLINE BasicBlock *executeCompiled(Hart *hart) {
+        return compiled_entry_.load(std::memory_order_acquire)(hart, this);
     }
 
     ALWAYS_INLINE CompilationStatus getCompilationStatus(std::memory_order memory_order) const {
@@ -87,17 +177,123 @@ public:
         return --hotness_counter_;
     }
 
+    // Tier 1 code asks for tier 2 again if the current request does not get it installed
+    ALWAYS_INLINE void resetTierUpCounter() {
+        tier_up_counter_ = TIER_UP_HOTNESS_COUNTER;
+    }
+
+    // Counter is shared with the compiler task, so the task keeps it after the block is evicted
+    ALWAYS_INLINE PendingExecutions startPendingExecutions() {
+        pending_executions_ = std::make_shared<std::atomic<uint32_t>>(0);
+        return pending_executions_;
+    }
+
+    // Only hart thread writes the counter, compiler threads read it to prioritize tasks
+    ALWAYS_INLINE void incrementPendingExecutions() {
+        if (pending_executions_ != nullptr) {
+            pending_executions_->store(pending_executions_->load(std::memory_order_relaxed) + 1,
+                                       std::memory_order_relaxed);
+        }
+    }
+
+    // Returns true only once, when block becomes head of a trace
+    ALWAYS_INLINE bool decrementTraceHotnessCounter() {
+        if (trace_hotness_counter_ == 0) {
+            return false;
+        }
+        return --trace_hotness_counter_ == 0;
+    }
+
+    ALWAYS_INLINE bool isTrace() const {
+        return is_trace_;
+    }
+
+    // Traces are never recorded starting from another trace
+    ALWAYS_INLINE void markAsTrace() {
+        is_trace_ = true;
+        trace_hotness_counter_ = 0;
+    }
+
+    // Set by compiler thread once trace starting from this block is ready to be executed
+    ALWAYS_INLINE bool hasTrace() const {
+        return has_trace_.load(std::memory_order_acquire);
+    }
+
+    ALWAYS_INLINE void setHasTrace(bool has_trace) {
+        has_trace_.store(has_trace, std::memory_order_release);
+    }
+
     ALWAYS_INLINE void setCompiledEntry(CompiledEntry compiled_entry) {
-        ASSERT(compiled_entry_ == nullptr);
-        compiled_entry_ = compiled_entry;
+        ASSERT(compiled_entry_.load(std::memory_order_relaxed) == nullptr);
+        compiled_entry_.store(compiled_entry, std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE CompiledEntry getCompiledEntry() const {
+        return compiled_entry_.load(std::memory_order_relaxed);
+    }
+
+    // Tier 2 code takes place of tier 1 one, which stays valid for the hart still executing it
+    ALWAYS_INLINE void replaceCompiledEntry(CompiledEntry compiled_entry) {
+        ASSERT(compiled_entry_.load(std::memory_order_relaxed) != nullptr);
+        compiled_entry_.store(compiled_entry, std::memory_order_release);
+    }
+
+    ALWAYS_INLINE BasicBlock **getLinkSlot(LinkIndex link_index) {
+        return &links_[link_index];
     }
 
+    // Patch exit slot of predecessor to jump straight into this block
+    void link(BasicBlock **slot);
+    // Indirect jump of this block has reached compiled target
+    void linkIndirect(BasicBlock &target);
+    // Called before block is evicted, so no compiled code can enter it through stale slot
+    void unlinkPredecessors();
+    // Compiled code was evicted from code cache, block is interpreted and warms up again
+    void resetCompiledCode();
+
+    static size_t getOffsetToEntrypoint();
+    static size_t getOffsetToCompiledEntry();
+    static size_t getOffsetToCompilationStatus();
+    static size_t getOffsetToHasTrace();
+    static size_t getOffsetToLinks();
+    static size_t getOffsetToIndirectLinks();
+    // Decremented by tier 1 code on every entry
+    static size_t getOffsetToTierUpCounter();
+
 private:
-    Body body_;
+    // Slot was relinked to another block
+    void forgetPredecessor(BasicBlock **slot);
+
+    ALWAYS_INLINE void setBody(Body body) {
+        body_size_ = body.size();
+        if (body_size_ <= INLINE_BODY_CAPACITY) {
+            std::copy(body.begin(), body.end(), inline_body_.begin());
+        } else {
+            long_body_ = std::move(body);
+        }
+    }
+
+    // Blocks keep their body next to the rest of fields, only traces are long enough to allocate it
+    std::array<DecodedInstruction, INLINE_BODY_CAPACITY> inline_body_{};
+    Body long_body_;
+    uint32_t body_size_{0};
+    DroppedNops dropped_nops_{0};
     Entrypoint entrypoint_;
     uint32_t hotness_counter_{START_HOTNESS_COUNTER};
-    CompiledEntry compiled_entry_{nullptr};
+    uint32_t trace_hotness_counter_{TRACE_START_HOTNESS_COUNTER};
+    bool is_trace_{false};
+    uint32_t tier_up_counter_{TIER_UP_HOTNESS_COUNTER};
+    std::atomic<CompiledEntry> compiled_entry_{nullptr};
     std::atomic<CompilationStatus> compilation_status_{CompilationStatus::NOT_COMPILED};
+    // Executions since block was queued for compilation
+    PendingExecutions pending_executions_;
+    std::atomic<bool> has_trace_{false};
+
+    std::array<BasicBlock *, LINK_COUNT> links_{};
+    std::array<IndirectLink, INDIRECT_LINK_COUNT> indirect_links_{};
+    // Entry replaced by the next target once all of them are in use
+    uint8_t next_indirect_link_ = 0;
+    std::vector<BasicBlock **> predecessors_;
 };
 
 }  // namespace RISCV
@@ -25,15 +25,23 @@ public:
         return std::nullopt;
     }
 
+    // Layout of the storage for compiled dispatcher, which looks blocks up by itself
+    using Slot = std::pair<BasicBlock::Entrypoint, BasicBlock>;
+
+    static size_t getOffsetToSlots() {
+        return MEMBER_OFFSET(BBCache, storage_);
+    }
+
     RetType insert(const BasicBlock::Entrypoint pc, BasicBlock bb) {
         const size_t idx = pc & checkBits;
+        storage_[idx].second.unlinkPredecessors();
         storage_[idx].first = pc;
         storage_[idx].second = std::move(bb);
         return std::ref(storage_[idx].second);
     }
 
 private:
-    std::pair<BasicBlock::Entrypoint, BasicBlock> storage_[CAPACITY];
+    Slot storage_[CAPACITY];
 };
 
 }  // namespace RISCV
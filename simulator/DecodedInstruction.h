@@ -7,8 +7,8 @@
 namespace RISCV {
 
 struct DecodedInstruction {
-    bool isJumpInstruction() {
-        switch (type) {
+    bool isJumpInstruction() const {
+        switch (getOriginalInstruction(type)) {
             case InstructionType::JAL:
             case InstructionType::JALR:
             case InstructionType::BEQ:
@@ -24,6 +24,28 @@ struct DecodedInstruction {
         }
     }
 
+    // Jumps which save return address into ra or t0 are calls, jumps through them are returns
+    bool isCall() const {
+        const InstructionType original = getOriginalInstruction(type);
+        return (original == InstructionType::JAL || original == InstructionType::JALR) && isLinkRegister(rd);
+    }
+
+    bool isReturn() const {
+        return getOriginalInstruction(type) == InstructionType::JALR && !isLinkRegister(rd) && isLinkRegister(rs1);
+    }
+
+    static bool isLinkRegister(RegisterType reg) {
+        return reg == RegisterType::RA || reg == RegisterType::T0;
+    }
+
+    // Immediates of RV64 fit into 32 bits, they are sign extended at use
+    union {
+        int32_t imm = 0;
+        uint32_t shamt;
+        uint32_t shamtw;
+        uint32_t aqrl;
+    };
+
     RegisterType rd;
     RegisterType rs1;
 
@@ -38,18 +60,21 @@ struct DecodedInstruction {
         uint8_t fm;
     };
 
-    union {
-        uint64_t imm = 0;
-        uint32_t shamt;
-        uint32_t shamtw;
-        uint32_t aqrl;
-    };
-
     // Initialize instruction to be invalid so every return will
     // be either valid instruction or invalid one
     InstructionType type = InstructionType::INSTRUCTION_INVALID;
+
+#if defined(RISCV_DIRECT_THREADED)
+    // Interpreter jumps here directly instead of looking type up in dispatch table
+    void *handler = nullptr;
+#endif
 };
 
+#if !defined(RISCV_DIRECT_THREADED)
+// Whole block body fits into a couple of cache lines
+static_assert(sizeof(DecodedInstruction) == 8);
+#endif
+
 }  // namespace RISCV
 
 #endif  // INCLUDE_DECODE_INSCTRUCTION_H
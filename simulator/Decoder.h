@@ -9,7 +9,12 @@ class DecodedInstruction;
 
 class Decoder {
 public:
+    // Common instructions are decoded by table lookup, the rest goes through decoder tree.
+    // Encoding must be a known instruction
     DecodedInstruction decodeInstruction(const EncodedInstruction encInstr) const;
+    // Unknown encoding, e.g. data placed in executable segment, gets INSTRUCTION_INVALID type
+    DecodedInstruction tryDecodeInstruction(const EncodedInstruction encInstr) const;
+    DecodedInstruction decodeInstructionByTree(const EncodedInstruction encInstr) const;
 };
 
 }  // namespace RISCV
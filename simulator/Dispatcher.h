@@ -1,7 +1,9 @@
 #ifndef INCLUDE_DISPATCHER_H
 #define INCLUDE_DISPATCHER_H
 
+#include "generated/InstructionTypes.h"
 #include "simulator/BasicBlock.h"
+#include "simulator/Executor.h"
 
 namespace RISCV {
 
@@ -9,12 +11,30 @@ class Hart;
 
 class Dispatcher {
 public:
-    Dispatcher(Hart *hart) : hart_(hart) {}
+    Dispatcher(Hart *hart) : hart_(hart) {
+#if defined(RISCV_DIRECT_THREADED)
+        static const DecodedInstruction empty_body[] = {DecodedInstruction{.type = BASIC_BLOCK_END}};
+        dispatchExecute(empty_body);
+#endif
+    }
 
     void dispatchExecute(BasicBlock::BodyEntry instr_iter);
 
+#if defined(RISCV_DIRECT_THREADED)
+    // Address of interpreter handler, resolved once per decoded instruction
+    ALWAYS_INLINE void *getHandler(InstructionType type) const {
+        return handlers_[type];
+    }
+#endif
+
+    // Out-of-line executor for compiled code which can not handle instruction natively
+    static Executor getExecutor(InstructionType type);
+
 private:
     Hart *hart_;
+#if defined(RISCV_DIRECT_THREADED)
+    void **handlers_ = nullptr;
+#endif
 };
 
 }  // namespace RISCV
@@ -14,14 +14,14 @@ namespace RISCV {
 // ================================ PC ================================= //
 
 static ALWAYS_INLINE void ExecutorLUI(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lui     x%d, %ld\n", instr.rd, instr.imm);
+    DEBUG_INSTRUCTION("lui     x%d, %d\n", instr.rd, instr.imm);
 
     hart->setReg(instr.rd, instr.imm);
     hart->incrementPC();
 }
 
 static ALWAYS_INLINE void ExecutorAUIPC(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("auipc   x%d, %ld\n", instr.rd, instr.imm);
+    DEBUG_INSTRUCTION("auipc   x%d, %d\n", instr.rd, instr.imm);
 
     hart->setReg(instr.rd, hart->getPC() + instr.imm);
     hart->incrementPC();
@@ -30,7 +30,7 @@ static ALWAYS_INLINE void ExecutorAUIPC(Hart *hart, const DecodedInstruction &in
 // =============================== Jumps =============================== //
 
 static ALWAYS_INLINE void ExecutorJAL(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("jal     x%d, %ld\n", instr.rd, instr.imm);
+    DEBUG_INSTRUCTION("jal     x%d, %d\n", instr.rd, instr.imm);
 
     hart->setReg(instr.rd, hart->getPC() + INSTRUCTION_BYTESIZE);
 
@@ -39,7 +39,7 @@ static ALWAYS_INLINE void ExecutorJAL(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorJALR(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("jalr    x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("jalr    x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     const memory::VirtAddr returnPC = hart->getPC() + INSTRUCTION_BYTESIZE;
     const memory::VirtAddr nextPC = (hart->getReg(instr.rs1) + instr.imm) & ~1ULL;
@@ -51,7 +51,7 @@ static ALWAYS_INLINE void ExecutorJALR(Hart *hart, const DecodedInstruction &ins
 // ============================= Branching ============================= //
 
 static ALWAYS_INLINE void ExecutorBEQ(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("beq     x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("beq     x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const SignedRegValue lhs = hart->getReg(instr.rs1);
     const SignedRegValue rhs = hart->getReg(instr.rs2);
@@ -68,7 +68,7 @@ static ALWAYS_INLINE void ExecutorBEQ(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorBNE(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("bne     x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("bne     x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const SignedRegValue lhs = hart->getReg(instr.rs1);
     const SignedRegValue rhs = hart->getReg(instr.rs2);
@@ -85,7 +85,7 @@ static ALWAYS_INLINE void ExecutorBNE(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorBLT(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("blt     x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("blt     x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const SignedRegValue lhs = hart->getReg(instr.rs1);
     const SignedRegValue rhs = hart->getReg(instr.rs2);
@@ -102,7 +102,7 @@ static ALWAYS_INLINE void ExecutorBLT(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorBGE(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("bge     x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("bge     x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const SignedRegValue lhs = hart->getReg(instr.rs1);
     const SignedRegValue rhs = hart->getReg(instr.rs2);
@@ -119,7 +119,7 @@ static ALWAYS_INLINE void ExecutorBGE(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorBLTU(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("bltu    x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("bltu    x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const RegValue lhs = hart->getReg(instr.rs1);
     const RegValue rhs = hart->getReg(instr.rs2);
@@ -136,7 +136,7 @@ static ALWAYS_INLINE void ExecutorBLTU(Hart *hart, const DecodedInstruction &ins
 }
 
 static ALWAYS_INLINE void ExecutorBGEU(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("bgeu    x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("bgeu    x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     const RegValue lhs = hart->getReg(instr.rs1);
     const RegValue rhs = hart->getReg(instr.rs2);
@@ -155,7 +155,7 @@ static ALWAYS_INLINE void ExecutorBGEU(Hart *hart, const DecodedInstruction &ins
 // =============================== Load ================================ //
 
 static ALWAYS_INLINE void ExecutorLB(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lb      x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lb      x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint8_t loaded;
 
@@ -170,7 +170,7 @@ static ALWAYS_INLINE void ExecutorLB(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorLH(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lh      x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lh      x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint16_t loaded;
 
@@ -191,7 +191,7 @@ static ALWAYS_INLINE void ExecutorLH(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorLW(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lw      x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lw      x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint32_t loaded;
 
@@ -212,7 +212,7 @@ static ALWAYS_INLINE void ExecutorLW(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorLD(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("ld      x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("ld      x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint64_t loaded;
 
@@ -233,7 +233,7 @@ static ALWAYS_INLINE void ExecutorLD(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorLBU(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lbu     x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lbu     x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint8_t loaded;
 
@@ -248,7 +248,7 @@ static ALWAYS_INLINE void ExecutorLBU(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorLHU(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lhu     x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lhu     x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint16_t loaded;
 
@@ -269,7 +269,7 @@ static ALWAYS_INLINE void ExecutorLHU(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorLWU(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("lwu     x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("lwu     x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint32_t loaded;
 
@@ -292,7 +292,7 @@ static ALWAYS_INLINE void ExecutorLWU(Hart *hart, const DecodedInstruction &inst
 // =============================== Store =============================== //
 
 static ALWAYS_INLINE void ExecutorSB(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("sb      x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("sb      x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     uint8_t stored = hart->getReg(instr.rs2);
 
@@ -306,7 +306,7 @@ static ALWAYS_INLINE void ExecutorSB(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorSH(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("sh      x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("sh      x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     uint16_t stored = hart->getReg(instr.rs2);
 
@@ -326,7 +326,7 @@ static ALWAYS_INLINE void ExecutorSH(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorSW(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("sw      x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("sw      x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     uint32_t stored = hart->getReg(instr.rs2);
 
@@ -346,7 +346,7 @@ static ALWAYS_INLINE void ExecutorSW(Hart *hart, const DecodedInstruction &instr
 }
 
 static ALWAYS_INLINE void ExecutorSD(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("sd      x%d, x%d, %ld\n", instr.rs1, instr.rs2, instr.imm);
+    DEBUG_INSTRUCTION("sd      x%d, x%d, %d\n", instr.rs1, instr.rs2, instr.imm);
 
     uint64_t stored = hart->getReg(instr.rs2);
 
@@ -368,7 +368,7 @@ static ALWAYS_INLINE void ExecutorSD(Hart *hart, const DecodedInstruction &instr
 // ======================= Arithmetic immediate ======================== //
 
 static ALWAYS_INLINE void ExecutorADDI(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("addi    x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("addi    x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     uint64_t sum = hart->getReg(instr.rs1) + instr.imm;
     hart->setReg(instr.rd, sum);
@@ -406,7 +406,7 @@ static ALWAYS_INLINE void ExecutorSLTIU(Hart *hart, const DecodedInstruction &in
 }
 
 static ALWAYS_INLINE void ExecutorXORI(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("xori    x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("xori    x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     RegValue res = hart->getReg(instr.rs1) ^ instr.imm;
     hart->setReg(instr.rd, res);
@@ -430,7 +430,7 @@ static ALWAYS_INLINE void ExecutorSRAI(Hart *hart, const DecodedInstruction &ins
 }
 
 static ALWAYS_INLINE void ExecutorORI(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("ori     x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("ori     x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     RegValue res = hart->getReg(instr.rs1) | instr.imm;
     hart->setReg(instr.rd, res);
@@ -438,7 +438,7 @@ static ALWAYS_INLINE void ExecutorORI(Hart *hart, const DecodedInstruction &inst
 }
 
 static ALWAYS_INLINE void ExecutorANDI(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("andi    x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("andi    x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     RegValue res = hart->getReg(instr.rs1) & instr.imm;
     hart->setReg(instr.rd, res);
@@ -446,7 +446,7 @@ static ALWAYS_INLINE void ExecutorANDI(Hart *hart, const DecodedInstruction &ins
 }
 
 static ALWAYS_INLINE void ExecutorADDIW(Hart *hart, const DecodedInstruction &instr) {
-    DEBUG_INSTRUCTION("addiw   x%d, x%d, %ld\n", instr.rd, instr.rs1, instr.imm);
+    DEBUG_INSTRUCTION("addiw   x%d, x%d, %d\n", instr.rd, instr.rs1, instr.imm);
 
     RegValue sum = hart->getReg(instr.rs1) + instr.imm;
     uint32_t sum32 = sum;
@@ -468,8 +468,8 @@ static ALWAYS_INLINE void ExecutorSLLIW(Hart *hart, const DecodedInstruction &in
 static ALWAYS_INLINE void ExecutorSRLIW(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("srliw   x%d, x%d, %d\n", instr.rd, instr.rs1, instr.shamt);
 
-    RegValue res = hart->getReg(instr.rs1) >> instr.shamt;
-    uint32_t res32 = res;
+    uint32_t rs1_32 = hart->getReg(instr.rs1);
+    uint32_t res32 = rs1_32 >> instr.shamt;
 
     hart->setReg(instr.rd, sext<31>(res32));
     hart->incrementPC();
@@ -601,8 +601,9 @@ static ALWAYS_INLINE void ExecutorSUBW(Hart *hart, const DecodedInstruction &ins
 static ALWAYS_INLINE void ExecutorSLLW(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("sllw    x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    RegValue res = hart->getReg(instr.rs1) << hart->getReg(instr.rs2);
-    uint32_t res32 = res;
+    // Only 5 lower bits of rs2 are the shift amount
+    uint32_t rs1_32 = hart->getReg(instr.rs1);
+    uint32_t res32 = rs1_32 << (hart->getReg(instr.rs2) & 0x1F);
     hart->setReg(instr.rd, sext<31>(res32));
     hart->incrementPC();
 }
@@ -610,8 +611,8 @@ static ALWAYS_INLINE void ExecutorSLLW(Hart *hart, const DecodedInstruction &ins
 static ALWAYS_INLINE void ExecutorSRLW(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("srlw    x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    RegValue res = hart->getReg(instr.rs1) >> hart->getReg(instr.rs2);
-    uint32_t res32 = res;
+    uint32_t rs1_32 = hart->getReg(instr.rs1);
+    uint32_t res32 = rs1_32 >> (hart->getReg(instr.rs2) & 0x1F);
     hart->setReg(instr.rd, sext<31>(res32));
     hart->incrementPC();
 }
@@ -619,17 +620,8 @@ static ALWAYS_INLINE void ExecutorSRLW(Hart *hart, const DecodedInstruction &ins
 static ALWAYS_INLINE void ExecutorSRAW(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("sraw    x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    SignedRegValue lhs = hart->getReg(instr.rs1);
-    SignedRegValue rhs = hart->getReg(instr.rs2);
-
-    SignedRegValue res = 0;
-
-    if (lhs < 0 && rhs > 0)
-        res = lhs >> rhs | ~(~0U >> rhs);
-    else
-        res = lhs >> rhs;
-
-    uint32_t res32 = res;
+    int32_t rs1_signed32 = hart->getReg(instr.rs1);
+    int32_t res32 = rs1_signed32 >> (hart->getReg(instr.rs2) & 0x1F);
     hart->setReg(instr.rd, sext<31>(res32));
     hart->incrementPC();
 }
@@ -664,10 +656,7 @@ static ALWAYS_INLINE void ExecutorFENCEI(Hart *hart, const DecodedInstruction &i
 static ALWAYS_INLINE void ExecutorMUL(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("mul     x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    uint64_t rs1_l = hart->getReg(instr.rs1) & 0xFFFFFFFF;
-    uint64_t rs2_l = hart->getReg(instr.rs2) & 0xFFFFFFFF;
-
-    uint64_t prod = rs1_l * rs2_l;
+    uint64_t prod = hart->getReg(instr.rs1) * hart->getReg(instr.rs2);
     hart->setReg(instr.rd, prod);
 
     hart->incrementPC();
@@ -676,12 +665,10 @@ static ALWAYS_INLINE void ExecutorMUL(Hart *hart, const DecodedInstruction &inst
 static ALWAYS_INLINE void ExecutorMULH(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("mulh    x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    uint64_t rs1_l = hart->getReg(instr.rs1) & 0xFFFFFFFF;
-    int64_t rs1_h = (hart->getReg(instr.rs1) & ~0xFFFFFFFF) >> 32;
-    uint64_t rs2_l = hart->getReg(instr.rs2) & 0xFFFFFFFF;
-    int64_t rs2_h = (hart->getReg(instr.rs2) & ~0xFFFFFFFF) >> 32;
+    SignedRegValue rs1 = hart->getReg(instr.rs1);
+    SignedRegValue rs2 = hart->getReg(instr.rs2);
 
-    int64_t prod = rs1_h * rs2_h + ((rs1_h * rs2_l + rs1_l * rs2_h) >> 32);
+    int64_t prod = (static_cast<__int128>(rs1) * rs2) >> 64;
     hart->setReg(instr.rd, prod);
 
     hart->incrementPC();
@@ -690,12 +677,10 @@ static ALWAYS_INLINE void ExecutorMULH(Hart *hart, const DecodedInstruction &ins
 static ALWAYS_INLINE void ExecutorMULHSU(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("mulhsu  x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    uint64_t rs1_l = hart->getReg(instr.rs1) & 0xFFFFFFFF;
-    int64_t rs1_h = (hart->getReg(instr.rs1) & ~0xFFFFFFFF) >> 32;
-    uint64_t rs2_l = hart->getReg(instr.rs2) & 0xFFFFFFFF;
-    uint64_t rs2_h = (hart->getReg(instr.rs2) & ~0xFFFFFFFF) >> 32;
+    SignedRegValue rs1 = hart->getReg(instr.rs1);
+    RegValue rs2 = hart->getReg(instr.rs2);
 
-    int64_t prod = rs1_h * rs2_h + ((rs1_h * rs2_l + rs1_l * rs2_h) >> 32);
+    int64_t prod = (static_cast<__int128>(rs1) * static_cast<__int128>(rs2)) >> 64;
     hart->setReg(instr.rd, prod);
 
     hart->incrementPC();
@@ -704,12 +689,10 @@ static ALWAYS_INLINE void ExecutorMULHSU(Hart *hart, const DecodedInstruction &i
 static ALWAYS_INLINE void ExecutorMULHU(Hart *hart, const DecodedInstruction &instr) {
     DEBUG_INSTRUCTION("mulhu   x%d, x%d, x%d\n", instr.rd, instr.rs1, instr.rs2);
 
-    uint64_t rs1_l = hart->getReg(instr.rs1) & 0xFFFFFFFF;
-    uint64_t rs1_h = (hart->getReg(instr.rs1) & ~0xFFFFFFFF) >> 32;
-    uint64_t rs2_l = hart->getReg(instr.rs2) & 0xFFFFFFFF;
-    uint64_t rs2_h = (hart->getReg(instr.rs2) & ~0xFFFFFFFF) >> 32;
+    RegValue rs1 = hart->getReg(instr.rs1);
+    RegValue rs2 = hart->getReg(instr.rs2);
 
-    uint64_t prod = rs1_h * rs2_h + ((rs1_h * rs2_l + rs1_l * rs2_h) >> 32);
+    uint64_t prod = (static_cast<unsigned __int128>(rs1) * rs2) >> 64;
     hart->setReg(instr.rd, prod);
 
     hart->incrementPC();
@@ -721,7 +704,13 @@ static ALWAYS_INLINE void ExecutorDIV(Hart *hart, const DecodedInstruction &inst
     int64_t dividend = hart->getReg(instr.rs1);
     int64_t divisor = hart->getReg(instr.rs2);
 
-    int64_t quot = dividend / divisor;
+    // Division by zero and overflow do not trap
+    int64_t quot = -1;
+    if (divisor == -1) {
+        quot = -static_cast<uint64_t>(dividend);
+    } else if (divisor != 0) {
+        quot = dividend / divisor;
+    }
     hart->setReg(instr.rd, quot);
 
     hart->incrementPC();
@@ -733,7 +722,7 @@ static ALWAYS_INLINE void ExecutorDIVU(Hart *hart, const DecodedInstruction &ins
     uint64_t dividend = hart->getReg(instr.rs1);
     uint64_t divisor = hart->getReg(instr.rs2);
 
-    uint64_t quot = dividend / divisor;
+    uint64_t quot = divisor == 0 ? UINT64_MAX : dividend / divisor;
     hart->setReg(instr.rd, quot);
 
     hart->incrementPC();
@@ -745,7 +734,12 @@ static ALWAYS_INLINE void ExecutorREM(Hart *hart, const DecodedInstruction &inst
     int64_t dividend = hart->getReg(instr.rs1);
     int64_t divisor = hart->getReg(instr.rs2);
 
-    int64_t rem = dividend % divisor;
+    int64_t rem = dividend;
+    if (divisor == -1) {
+        rem = 0;
+    } else if (divisor != 0) {
+        rem = dividend % divisor;
+    }
     hart->setReg(instr.rd, rem);
 
     hart->incrementPC();
@@ -757,7 +751,7 @@ static ALWAYS_INLINE void ExecutorREMU(Hart *hart, const DecodedInstruction &ins
     uint64_t dividend = hart->getReg(instr.rs1);
     uint64_t divisor = hart->getReg(instr.rs2);
 
-    uint64_t rem = dividend % divisor;
+    uint64_t rem = divisor == 0 ? dividend : dividend % divisor;
     hart->setReg(instr.rd, rem);
 
     hart->incrementPC();
@@ -781,7 +775,12 @@ static ALWAYS_INLINE void ExecutorDIVW(Hart *hart, const DecodedInstruction &ins
     int32_t dividend32 = hart->getReg(instr.rs1);
     int32_t divisor32 = hart->getReg(instr.rs2);
 
-    int32_t quot32 = dividend32 / divisor32;
+    int32_t quot32 = -1;
+    if (divisor32 == -1) {
+        quot32 = -static_cast<uint32_t>(dividend32);
+    } else if (divisor32 != 0) {
+        quot32 = dividend32 / divisor32;
+    }
     hart->setReg(instr.rd, sext<31>(quot32));
 
     hart->incrementPC();
@@ -793,7 +792,7 @@ static ALWAYS_INLINE void ExecutorDIVUW(Hart *hart, const DecodedInstruction &in
     uint32_t dividend32 = hart->getReg(instr.rs1);
     uint32_t divisor32 = hart->getReg(instr.rs2);
 
-    uint32_t quot32 = dividend32 / divisor32;
+    uint32_t quot32 = divisor32 == 0 ? UINT32_MAX : dividend32 / divisor32;
     hart->setReg(instr.rd, sext<31>(quot32));
 
     hart->incrementPC();
@@ -805,7 +804,12 @@ static ALWAYS_INLINE void ExecutorREMW(Hart *hart, const DecodedInstruction &ins
     int32_t dividend32 = hart->getReg(instr.rs1);
     int32_t divisor32 = hart->getReg(instr.rs2);
 
-    int32_t rem32 = dividend32 % divisor32;
+    int32_t rem32 = dividend32;
+    if (divisor32 == -1) {
+        rem32 = 0;
+    } else if (divisor32 != 0) {
+        rem32 = dividend32 % divisor32;
+    }
     hart->setReg(instr.rd, sext<31>(rem32));
 
     hart->incrementPC();
@@ -817,7 +821,7 @@ static ALWAYS_INLINE void ExecutorREMUW(Hart *hart, const DecodedInstruction &in
     uint32_t dividend32 = hart->getReg(instr.rs1);
     uint32_t divisor32 = hart->getReg(instr.rs2);
 
-    uint32_t rem32 = dividend32 % divisor32;
+    uint32_t rem32 = divisor32 == 0 ? dividend32 : dividend32 % divisor32;
     hart->setReg(instr.rd, sext<31>(rem32));
 
     hart->incrementPC();
@@ -1351,6 +1355,121 @@ static ALWAYS_INLINE void ExecutorFNMADDQ(Hart *hart, const DecodedInstruction &
     UNREACHABLE();
 }
 
+// ======================== Operand specialized ======================== //
+// NOP takes every ADDI writing x0, so LI and MV always have a real destination
+
+static ALWAYS_INLINE void ExecutorNOP(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("nop\n");
+
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorLI(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("li      x%d, %d\n", instr.rd, instr.imm);
+
+    hart->setNonZeroReg(instr.rd, instr.imm);
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorMV(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("mv      x%d, x%d\n", instr.rd, instr.rs1);
+
+    hart->setNonZeroReg(instr.rd, hart->getReg(instr.rs1));
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorJ(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("j       %d\n", instr.imm);
+
+    hart->setPC(hart->getPC() + instr.imm);
+}
+
+static ALWAYS_INLINE void ExecutorRET(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("ret\n");
+
+    hart->setPC(hart->getReg(RegisterType::RA) & ~1ULL);
+}
+
+static ALWAYS_INLINE void ExecutorJR(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("jr      x%d, %d\n", instr.rs1, instr.imm);
+
+    hart->setPC((hart->getReg(instr.rs1) + instr.imm) & ~1ULL);
+}
+
+static ALWAYS_INLINE void ExecutorSB_ZERO(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("sb      x%d, x0, %d\n", instr.rs1, instr.imm);
+
+    uint8_t stored = 0;
+
+    memory::VirtAddr vaddr = hart->getReg(instr.rs1) + instr.imm;
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::WMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.write(paddr, sizeof(stored), &stored);
+
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorSH_ZERO(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("sh      x%d, x0, %d\n", instr.rs1, instr.imm);
+
+    uint16_t stored = 0;
+
+    memory::VirtAddr vaddr = hart->getReg(instr.rs1) + instr.imm;
+
+    if (UNLIKELY(vaddr % sizeof(stored))) {
+        std::cerr << "Error: unaligned memory access" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::WMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.write(paddr, sizeof(stored), &stored);
+
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorSW_ZERO(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("sw      x%d, x0, %d\n", instr.rs1, instr.imm);
+
+    uint32_t stored = 0;
+
+    memory::VirtAddr vaddr = hart->getReg(instr.rs1) + instr.imm;
+
+    if (UNLIKELY(vaddr % sizeof(stored))) {
+        std::cerr << "Error: unaligned memory access" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::WMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.write(paddr, sizeof(stored), &stored);
+
+    hart->incrementPC();
+}
+
+static ALWAYS_INLINE void ExecutorSD_ZERO(Hart *hart, const DecodedInstruction &instr) {
+    DEBUG_INSTRUCTION("sd      x%d, x0, %d\n", instr.rs1, instr.imm);
+
+    uint64_t stored = 0;
+
+    memory::VirtAddr vaddr = hart->getReg(instr.rs1) + instr.imm;
+
+    if (UNLIKELY(vaddr % sizeof(stored))) {
+        std::cerr << "Error: unaligned memory access" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    memory::PhysAddr paddr = hart->getPhysAddr<memory::MemoryType::WMem>(vaddr);
+
+    memory::PhysicalMemory &pmem = memory::getPhysicalMemory();
+    pmem.write(paddr, sizeof(stored), &stored);
+
+    hart->incrementPC();
+}
+
 }  // namespace RISCV
 
 #endif  // EXECUTOR_INL_H
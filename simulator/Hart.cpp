@@ -1,6 +1,8 @@
 #include "simulator/Hart.h"
 
 #include <iostream>
+#include <unordered_set>
+#include <utility>
 
 #include "compiler/Compiler.h"
 #include "utils/macros.h"
@@ -9,13 +11,15 @@ namespace RISCV {
 
 using namespace memory;
 
-BasicBlock Hart::fetchBasicBlock() {
+static thread_local Hart *runningHart = nullptr;
+
+std::optional<BasicBlock> Hart::fetchBasicBlock(VirtAddr pc, bool isSpeculative) {
     EncodedInstruction encInstr[BasicBlock::MAX_SIZE];
     std::vector<DecodedInstruction> bbBody;
     bbBody.reserve(BasicBlock::MAX_SIZE);
 
     PhysicalMemory &pmem = getPhysicalMemory();
-    PhysAddr paddr = getPhysAddr<memory::MemoryType::IMem>(pc_);
+    PhysAddr paddr = getPhysAddr<memory::MemoryType::IMem>(pc);
 
     constexpr const size_t maxBasicBlockBytesize = INSTRUCTION_BYTESIZE * BasicBlock::MAX_SIZE;
     constexpr const uint32_t maxOffsetForFullBB = PAGE_BYTESIZE - maxBasicBlockBytesize;
@@ -32,24 +36,295 @@ BasicBlock Hart::fetchBasicBlock() {
 
     pmem.read(paddr, readBytesize, encInstr);
     for (size_t i = 0; i < readInstructions; ++i) {
-        auto &decInstr = bbBody.emplace_back(decode(encInstr[i]));
+        auto &decInstr =
+            bbBody.emplace_back(isSpeculative ? decoder_.tryDecodeInstruction(encInstr[i]) : decode(encInstr[i]));
+        if (UNLIKELY(decInstr.type == InstructionType::INSTRUCTION_INVALID)) {
+            return std::nullopt;
+        }
         if (UNLIKELY(decInstr.isJumpInstruction())) {
             break;
         }
     }
 
-    bbBody.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+    const BasicBlock::DroppedNops droppedNops = BasicBlock::prepareBody(bbBody);
+
+#if defined(RISCV_DIRECT_THREADED)
+    for (auto &instr : bbBody) {
+        instr.handler = dispatcher_.getHandler(instr.type);
+    }
+#endif
+
+    return BasicBlock(std::move(bbBody), pc, droppedNops);
+}
+
+void Hart::translateAheadOfTime(const ProgramText &text) {
+    if (!compiler::Compiler::isAheadOfTimeEnabled()) {
+        return;
+    }
+
+    std::vector<BasicBlock::Entrypoint> worklist;
+    auto addTarget = [&text, &worklist](VirtAddr target) {
+        if (target % INSTRUCTION_BYTESIZE != 0) {
+            return;
+        }
+        for (const auto &[start, end] : text.ranges) {
+            if (start <= target && target < end) {
+                worklist.push_back(target);
+                return;
+            }
+        }
+    };
+
+    for (VirtAddr entrypoint : text.entrypoints) {
+        addTarget(entrypoint);
+    }
+
+    std::unordered_set<BasicBlock::Entrypoint> visited;
+    std::vector<BasicBlock> blocks;
+    while (!worklist.empty() && blocks.size() < MAX_AOT_BLOCKS) {
+        const BasicBlock::Entrypoint entrypoint = worklist.back();
+        worklist.pop_back();
+        if (!visited.insert(entrypoint).second) {
+            continue;
+        }
+
+        auto fetched = fetchBasicBlock(entrypoint, true);
+        // Zero padding or data in executable segment, the path is not followed further
+        if (!fetched.has_value()) {
+            continue;
+        }
+        auto &bb = blocks.emplace_back(std::move(*fetched));
+        const auto &lastInstr = bb.getLastInstr();
+        const VirtAddr lastPC = entrypoint + INSTRUCTION_BYTESIZE * (bb.getInstrCount() - 1);
+
+        switch (getOriginalInstruction(lastInstr.type)) {
+            case InstructionType::BEQ:
+            case InstructionType::BNE:
+            case InstructionType::BLT:
+            case InstructionType::BGE:
+            case InstructionType::BLTU:
+            case InstructionType::BGEU:
+                addTarget(lastPC + lastInstr.imm);
+                addTarget(lastPC + INSTRUCTION_BYTESIZE);
+                break;
+            case InstructionType::JAL:
+                addTarget(lastPC + lastInstr.imm);
+                // Calls return right after themselves
+                if (lastInstr.rd != RegisterType::ZERO) {
+                    addTarget(lastPC + INSTRUCTION_BYTESIZE);
+                }
+                break;
+            case InstructionType::JALR:
+                if (lastInstr.rd != RegisterType::ZERO) {
+                    addTarget(lastPC + INSTRUCTION_BYTESIZE);
+                }
+                break;
+            default:
+                // Syscall or block split by size limit
+                addTarget(lastPC + INSTRUCTION_BYTESIZE);
+                break;
+        }
+    }
+
+    compiler_.compileAheadOfTime(blocks);
+}
 
-    return BasicBlock(std::move(bbBody), pc_);
+void Hart::run() {
+    runningHart = this;
+    auto dispatch = compiler_.getDispatcher();
+    while (pc_ != 0) {
+        // Dispatcher returns once runtime has to take control, block then goes through the usual path
+        if (LIKELY(dispatch != nullptr)) {
+            dispatch(this);
+            if (pc_ == 0) {
+                break;
+            }
+        }
+        executeBasicBlock(getBasicBlock());
+    }
 }
 
 void Hart::executeBasicBlock(BasicBlock &bb) {
+    BasicBlock **pendingLink = std::exchange(pending_link_, nullptr);
+    BasicBlock *pendingIndirectLink = std::exchange(pending_indirect_link_, nullptr);
+    BasicBlock *pendingReturnLink = std::exchange(pending_return_link_, nullptr);
+
+    if (bb.getEntrypoint() <= lastEntrypoint_) {
+        onBackwardJump(bb);
+    }
+    lastEntrypoint_ = bb.getEntrypoint();
+
+    if (UNLIKELY(traceRecorder_.isRecording())) {
+        recordBasicBlock(bb);
+        return;
+    }
+
     auto isNotCompiled = compiler_.decrementHotnessCounter(bb);
     if (UNLIKELY(isNotCompiled)) {
         dispatcher_.dispatchExecute(bb.getBodyEntry());
+        instr_count_ += bb.getInstrCount();
+        updateReturnStack(bb);
         return;
     }
-    bb.executeCompiled(this);
+
+    if (pendingLink != nullptr) {
+        bb.link(pendingLink);
+    }
+    if (pendingIndirectLink != nullptr) {
+        pendingIndirectLink->linkIndirect(bb);
+    }
+    if (pendingReturnLink != nullptr) {
+        linkReturn(*pendingReturnLink, bb);
+    }
+
+    BasicBlock *curr = &bb;
+    while (BasicBlock *next = curr->executeCompiled(this)) {
+        if (next->getEntrypoint() <= curr->getEntrypoint() && UNLIKELY(onBackwardJump(*next))) {
+            break;
+        }
+        curr = next;
+    }
+    lastEntrypoint_ = curr->getEntrypoint();
+}
+
+void Hart::restoreGuestState() {
+    if (slow_path_return_address_ == nullptr) {
+        return;
+    }
+    auto pc = compiler_.findGuestPC(slow_path_return_address_);
+    if (pc != std::nullopt) {
+        pc_ = *pc;
+    }
+    slow_path_return_address_ = nullptr;
+}
+
+bool Hart::handleMMUException(const MMU::Exception exception) {
+    if (runningHart != nullptr) {
+        runningHart->restoreGuestState();
+        std::cerr << "Guest pc: 0x" << std::hex << runningHart->getPC() << std::dec << std::endl;
+    }
+    return defaultMMUExceptionHandler(exception);
+}
+
+void Hart::updateReturnStack(BasicBlock &bb) {
+    const auto &lastInstr = bb.getLastInstr();
+    if (lastInstr.isCall()) {
+        return_stack_top_ = (return_stack_top_ + 1) % RETURN_STACK_SIZE;
+        return_stack_[return_stack_top_] = {bb.getEntrypoint() + INSTRUCTION_BYTESIZE * bb.getInstrCount(), &bb};
+    } else if (lastInstr.isReturn()) {
+        return_stack_top_ = (return_stack_top_ - 1) % RETURN_STACK_SIZE;
+    }
+}
+
+void Hart::linkReturn(BasicBlock &caller, BasicBlock &bb) {
+    // Caller could be evicted since the call, then its slot belongs to another block falling through elsewhere
+    if (caller.isTrace() || caller.getEntrypoint() + INSTRUCTION_BYTESIZE * caller.getInstrCount() != bb.getEntrypoint()) {
+        return;
+    }
+    bb.link(caller.getLinkSlot(BasicBlock::FALLTHROUGH_LINK));
+}
+
+bool Hart::onBackwardJump(BasicBlock &bb) {
+    if (bb.hasTrace()) {
+        return true;
+    }
+
+    if (bb.decrementTraceHotnessCounter() && !traceRecorder_.isRecording()) {
+        traceRecorder_.start(bb.getEntrypoint());
+        return true;
+    }
+    return false;
+}
+
+void Hart::recordBasicBlock(BasicBlock &bb) {
+    // Blocks are executed one at a time so recorder sees every transition.
+    // Linked successor of compiled block is dropped, PC already points to it
+    auto isNotCompiled = compiler_.decrementHotnessCounter(bb);
+    if (isNotCompiled) {
+        dispatcher_.dispatchExecute(bb.getBodyEntry());
+        instr_count_ += bb.getInstrCount();
+        updateReturnStack(bb);
+    } else {
+        bb.executeCompiled(this);
+    }
+
+    if (traceRecorder_.append(bb, pc_)) {
+        auto trace = traceRecorder_.finish();
+        if (trace != std::nullopt) {
+            cacheTrace(std::move(*trace));
+        }
+    }
+}
+
+void Hart::cacheTrace(Trace trace) {
+    BasicBlock traceBb(std::move(trace.body), trace.entrypoint);
+    traceBb.markAsTrace();
+    dropPendingLinks();
+
+    std::unique_lock holder(bb_cache_lock_);
+    auto oldTrace = traceCache_.find(trace.entrypoint);
+    // Compiled code of previous trace would be installed into the new one
+    if (oldTrace != std::nullopt &&
+        oldTrace->get().getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILING) {
+        return;
+    }
+    auto &traceRef = traceCache_.insert(trace.entrypoint, std::move(traceBb)).get();
+    holder.unlock();
+
+    compiler_.compileTrace(traceRef, std::move(trace.pcs));
+}
+
+BasicBlock &Hart::getTrace(BasicBlock &head) {
+    auto trace = traceCache_.find(head.getEntrypoint());
+    if (UNLIKELY(trace == std::nullopt)) {
+        // Trace was evicted
+        head.setHasTrace(false);
+        return head;
+    }
+
+    auto &traceRef = trace->get();
+    if (traceRef.getCompilationStatus(std::memory_order_acquire) != CompilationStatus::COMPILED) {
+        return head;
+    }
+
+    // Compiled predecessors are relinked to the trace once they exit to runtime
+    head.unlinkPredecessors();
+    return traceRef;
+}
+
+BasicBlock *Hart::findCachedBlock(BasicBlock::Entrypoint entrypoint, bool isTrace) {
+    auto bb = isTrace ? traceCache_.find(entrypoint) : bbCache_.find(entrypoint);
+    return bb != std::nullopt ? &bb->get() : nullptr;
+}
+
+void Hart::collectCode() {
+    std::lock_guard holder(bb_cache_lock_);
+    auto victims = compiler_.collectCode([this](const compiler::CodeCache::Record &record) {
+        BasicBlock *bb = findCachedBlock(record.entrypoint, record.is_trace);
+        return bb != nullptr && bb->getCompiledEntry() == record.entry;
+    });
+
+    for (const auto &victim : victims) {
+        BasicBlock *bb = findCachedBlock(victim.entrypoint, victim.is_trace);
+        if (bb == nullptr || bb->getCompiledEntry() != victim.entry) {
+            continue;
+        }
+
+        if (victim.replacement != nullptr) {
+            bb->replaceCompiledEntry(victim.replacement);
+            continue;
+        }
+
+        bb->resetCompiledCode();
+        // Trace is never interpreted, blocks it consists of are executed instead
+        if (victim.is_trace) {
+            BasicBlock *head = findCachedBlock(victim.entrypoint, false);
+            if (head != nullptr) {
+                head->setHasTrace(false);
+            }
+        }
+    }
+    compiler_.releaseCode(victims);
 }
 
 DecodedInstruction Hart::decode(const EncodedInstruction encInstr) const {
@@ -74,8 +349,12 @@ Hart::Hart() : dispatcher_(this), compiler_(this) {
                                makePartialBits<0, 43>(satpPPN);
 
     mmu_.setSATPReg(csrRegs_[CSR_SATP_INDEX]);
+    mmu_.setExceptionHandler(handleMMUException);
     pmem.allocatePage(satpPPN);
 
+    raw_memory_ = pmem.getRawMemory();
+    helpers_ = &compiler::getRuntimeHelpers();
+
     compiler_.InitializeWorker();
 }
 
@@ -83,17 +362,79 @@ Hart::~Hart() {
     compiler_.FinalizeWorker();
 }
 
-void Hart::setBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry) {
+bool Hart::setBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry) {
     std::lock_guard holder(bb_cache_lock_);
     auto bb = bbCache_.find(entrypoint);
 
     if (UNLIKELY(bb == std::nullopt)) {
-        return;
+        return false;
     }
 
+    // Block could be evicted and fetched again while the first task was compiled by another worker
     auto &bbRef = bb->get();
+    if (UNLIKELY(bbRef.getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILED)) {
+        return false;
+    }
     bbRef.setCompiledEntry(entry);
     bbRef.setCompilationStatus(CompilationStatus::COMPILED, std::memory_order_seq_cst);
+    return true;
+}
+
+bool Hart::setTraceEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry) {
+    std::lock_guard holder(bb_cache_lock_);
+    auto trace = traceCache_.find(entrypoint);
+
+    if (UNLIKELY(trace == std::nullopt)) {
+        return false;
+    }
+
+    auto &traceRef = trace->get();
+    if (UNLIKELY(traceRef.getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILED)) {
+        return false;
+    }
+    traceRef.setCompiledEntry(entry);
+    traceRef.setCompilationStatus(CompilationStatus::COMPILED, std::memory_order_seq_cst);
+
+    // Head block redirects runtime to the trace from now on
+    auto head = bbCache_.find(entrypoint);
+    if (head != std::nullopt) {
+        head->get().setHasTrace(true);
+    }
+    return true;
+}
+
+bool Hart::setOptimizedBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry) {
+    std::lock_guard holder(bb_cache_lock_);
+    auto bb = bbCache_.find(entrypoint);
+
+    // Block could be evicted and fetched again, then it waits for its own tier 1 code
+    if (UNLIKELY(bb == std::nullopt ||
+                 bb->get().getCompilationStatus(std::memory_order_relaxed) != CompilationStatus::COMPILED)) {
+        return false;
+    }
+    bb->get().replaceCompiledEntry(entry);
+    return true;
+}
+
+bool Hart::isBBCompiling(BasicBlock::Entrypoint entrypoint) {
+    std::lock_guard holder(bb_cache_lock_);
+    auto bb = bbCache_.find(entrypoint);
+    return bb != std::nullopt &&
+           bb->get().getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILING;
+}
+
+bool Hart::isBBCompiled(BasicBlock::Entrypoint entrypoint) {
+    std::lock_guard holder(bb_cache_lock_);
+    auto bb = bbCache_.find(entrypoint);
+    return bb != std::nullopt &&
+           bb->get().getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILED;
+}
+
+bool Hart::isTraceCompiling(BasicBlock::Entrypoint entrypoint) {
+    std::lock_guard holder(bb_cache_lock_);
+    auto trace = traceCache_.find(entrypoint);
+    return trace != std::nullopt &&
+           trace->get().getCompilationStatus(std::memory_order_relaxed) == CompilationStatus::COMPILING;
 }
 
 size_t Hart::getOffsetToRegs() {
@@ -104,4 +445,64 @@ size_t Hart::getOffsetToPc() {
     return MEMBER_OFFSET(Hart, pc_);
 }
 
+size_t Hart::getOffsetToTLB() {
+    return MEMBER_OFFSET(Hart, tlb_);
+}
+
+size_t Hart::getOffsetToPendingLink() {
+    return MEMBER_OFFSET(Hart, pending_link_);
+}
+
+size_t Hart::getOffsetToPendingIndirectLink() {
+    return MEMBER_OFFSET(Hart, pending_indirect_link_);
+}
+
+size_t Hart::getOffsetToPendingReturnLink() {
+    return MEMBER_OFFSET(Hart, pending_return_link_);
+}
+
+size_t Hart::getOffsetToReturnStack() {
+    return MEMBER_OFFSET(Hart, return_stack_);
+}
+
+size_t Hart::getOffsetToReturnStackTop() {
+    return MEMBER_OFFSET(Hart, return_stack_top_);
+}
+
+size_t Hart::getOffsetToInstrCount() {
+    return MEMBER_OFFSET(Hart, instr_count_);
+}
+
+size_t Hart::getOffsetToLastEntrypoint() {
+    return MEMBER_OFFSET(Hart, lastEntrypoint_);
+}
+
+size_t Hart::getOffsetToIsRecording() {
+    return MEMBER_OFFSET(Hart, traceRecorder_) + TraceRecorder::getOffsetToIsRecording();
+}
+
+size_t Hart::getOffsetToBBCacheSlots() {
+    return MEMBER_OFFSET(Hart, bbCache_) + BBCache<BB_CACHE_CAPACITY>::getOffsetToSlots();
+}
+
+size_t Hart::getBBCacheSlotSize() {
+    return sizeof(BBCache<BB_CACHE_CAPACITY>::Slot);
+}
+
+size_t Hart::getBBCacheSlotKeyOffset() {
+    return MEMBER_OFFSET(BBCache<BB_CACHE_CAPACITY>::Slot, first);
+}
+
+size_t Hart::getBBCacheSlotBlockOffset() {
+    return MEMBER_OFFSET(BBCache<BB_CACHE_CAPACITY>::Slot, second);
+}
+
+size_t Hart::getOffsetToRawMemory() {
+    return MEMBER_OFFSET(Hart, raw_memory_);
+}
+
+size_t Hart::getOffsetToHelpers() {
+    return MEMBER_OFFSET(Hart, helpers_);
+}
+
 }  // namespace RISCV
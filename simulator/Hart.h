@@ -3,20 +3,44 @@
 
 #include <array>
 #include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
 
 #include "compiler/Compiler.h"
+#include "compiler/RuntimeHelpers.h"
 #include "simulator/BasicBlock.h"
 #include "simulator/Cache.h"
 #include "simulator/Common.h"
 #include "simulator/Decoder.h"
 #include "simulator/Dispatcher.h"
+#include "simulator/TraceRecorder.h"
 #include "simulator/memory/MMU.h"
 
 namespace RISCV {
 
+// Executable part of loaded program known before execution
+struct ProgramText {
+    // [start, end) of executable segments
+    std::vector<std::pair<memory::VirtAddr, memory::VirtAddr>> ranges;
+    // ELF entry point and function symbols
+    std::vector<memory::VirtAddr> entrypoints;
+};
+
 class Hart final {
 public:
     static constexpr size_t BB_CACHE_CAPACITY = 1024;
+    static constexpr size_t TRACE_CACHE_CAPACITY = 256;
+    static constexpr size_t MAX_AOT_BLOCKS = 1 << 16;
+    // Circular, the oldest calls are overwritten by deep recursion
+    static constexpr size_t RETURN_STACK_SIZE = 16;
+
+    // Return address pushed by call. Its block falls through to the return address, so the fallthrough link of the
+    // caller is where returns find compiled continuation
+    struct ReturnAddress {
+        memory::VirtAddr pc;
+        BasicBlock *caller;
+    };
 
     Hart();
     ~Hart();
@@ -34,6 +58,12 @@ public:
         regs_[RegisterType::ZERO] = 0;
     }
 
+    // Decoder proved the destination is not x0, so it needs no reset
+    ALWAYS_INLINE void setNonZeroReg(const RegisterType id, const RegValue val) {
+        ASSERT(id != RegisterType::ZERO);
+        regs_[id] = val;
+    }
+
     ALWAYS_INLINE void incrementPC() {
         pc_ += INSTRUCTION_BYTESIZE;
     }
@@ -48,22 +78,80 @@ public:
 
     void executeBasicBlock(BasicBlock &bb);
 
+    // Runs the program until PC becomes 0
+    void run();
+
+    // Discovers blocks reachable from known entrypoints by direct jumps and compiles all of them.
+    // Targets of indirect jumps found at runtime go through the usual interpreter and JIT path
+    void translateAheadOfTime(const ProgramText &text);
+
+    // Enables code saved by previous runs of program with the same text
+    void openPersistentCache(uint64_t programHash) {
+        compiler_.openPersistentCache(programHash);
+    }
+
+    // Compiled code can leave trace in the middle, so it updates the counter itself
+    ALWAYS_INLINE uint64_t getInstrCount() const {
+        return instr_count_;
+    }
+
     ALWAYS_INLINE auto cacheBasicBlock(BasicBlock::Entrypoint entrypoint, BasicBlock bb) {
+        // Pending predecessor could be evicted by the new block, then its slot belongs to another one
+        dropPendingLinks();
         std::lock_guard holder(bb_cache_lock_);
         return bbCache_.insert(entrypoint, std::move(bb));
     }
 
     ALWAYS_INLINE BasicBlock &getBasicBlock() {
+        // No block is referenced by runtime here, so their code can be detached
+        if (UNLIKELY(compiler_.needsCodeCollection())) {
+            collectCode();
+        }
+
         auto bb = bbCache_.find(pc_);
         if (LIKELY(bb != std::nullopt)) {
+            if (UNLIKELY(bb->get().hasTrace())) {
+                return getTrace(*bb);
+            }
             return *bb;
         }
-        auto newBb = fetchBasicBlock();
+        auto newBb = fetchBasicBlock(pc_);
+        compiler_.installPrecompiledCode(newBb);
         auto bbRef = cacheBasicBlock(pc_, std::move(newBb));
         return bbRef;
     }
 
-    void setBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry);
+    // Slow paths called by compiled code remember where they return to, PC is not stored by the caller
+    ALWAYS_INLINE void enterSlowPath(const void *returnAddress) {
+        slow_path_return_address_ = returnAddress;
+    }
+
+    ALWAYS_INLINE void leaveSlowPath() {
+        slow_path_return_address_ = nullptr;
+    }
+
+    // Makes PC precise for exception raised inside slow path, it is found in side table of the caller
+    void restoreGuestState();
+
+    // Called from tier 1 code of hot block
+    void optimizeBasicBlock(BasicBlock &bb) {
+        // Tier 2 task may be dropped as stale or fail to compile, the block asks again after rearmed counter runs out
+        bb.resetTierUpCounter();
+        compiler_.optimizeBasicBlock(bb);
+    }
+
+    // Return false if block is not in cache anymore and compiled code is not used
+    bool setBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry);
+    bool setTraceEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry);
+    // Replaces tier 1 code of the block by tier 2 one
+    bool setOptimizedBBEntry(BasicBlock::Entrypoint entrypoint, BasicBlock::CompiledEntry entry);
+    bool isBBCompiling(BasicBlock::Entrypoint entrypoint);
+    bool isBBCompiled(BasicBlock::Entrypoint entrypoint);
+    bool isTraceCompiling(BasicBlock::Entrypoint entrypoint);
+
+    ALWAYS_INLINE compiler::CompilerStats &getCompilerStats() {
+        return compiler_.getStats();
+    }
 
     ALWAYS_INLINE const memory::MMU &getTranslator() const {
         return mmu_;
@@ -91,13 +179,69 @@ public:
 
     static size_t getOffsetToRegs();
     static size_t getOffsetToPc();
+    static size_t getOffsetToTLB();
+    static size_t getOffsetToPendingLink();
+    static size_t getOffsetToPendingIndirectLink();
+    static size_t getOffsetToPendingReturnLink();
+    static size_t getOffsetToReturnStack();
+    static size_t getOffsetToReturnStackTop();
+    static size_t getOffsetToInstrCount();
+    static size_t getOffsetToLastEntrypoint();
+    static size_t getOffsetToIsRecording();
+    static size_t getOffsetToBBCacheSlots();
+    static size_t getBBCacheSlotSize();
+    static size_t getBBCacheSlotKeyOffset();
+    static size_t getBBCacheSlotBlockOffset();
+    static size_t getOffsetToRawMemory();
+    static size_t getOffsetToHelpers();
 
 private:
-    BasicBlock fetchBasicBlock();
+    ALWAYS_INLINE BasicBlock fetchBasicBlock(memory::VirtAddr pc) {
+        return std::move(*fetchBasicBlock(pc, false));
+    }
+    // Speculative fetch is for code which may never run, it gives up on unknown encoding instead of asserting
+    std::optional<BasicBlock> fetchBasicBlock(memory::VirtAddr pc, bool isSpeculative);
+    BasicBlock &getTrace(BasicBlock &head);
+    void cacheTrace(Trace trace);
+    // Returns true if runtime has to take control: trace recording started or trace is ready
+    bool onBackwardJump(BasicBlock &bb);
+    void recordBasicBlock(BasicBlock &bb);
+
+    ALWAYS_INLINE void dropPendingLinks() {
+        pending_link_ = nullptr;
+        pending_indirect_link_ = nullptr;
+        pending_return_link_ = nullptr;
+    }
+
+    // MMU reports exceptions without context, they belong to the hart running on this thread
+    static bool handleMMUException(const memory::MMU::Exception exception);
+
+    // Compiled code maintains the stack itself
+    void updateReturnStack(BasicBlock &bb);
+    void linkReturn(BasicBlock &caller, BasicBlock &bb);
+
+    // Releases code replaced or evicted by code cache, blocks holding it switch to newer code or go back to interpreter
+    void collectCode();
+    BasicBlock *findCachedBlock(BasicBlock::Entrypoint entrypoint, bool isTrace);
     EncodedInstruction fetch();
     DecodedInstruction decode(const EncodedInstruction encInstr) const;
 
     memory::VirtAddr pc_;
+    // Exit slot of the last compiled block which wants to be linked with the next executed one
+    BasicBlock **pending_link_ = nullptr;
+    // Block whose indirect jump missed its inline cache
+    BasicBlock *pending_indirect_link_ = nullptr;
+    // Caller whose return found no compiled continuation
+    BasicBlock *pending_return_link_ = nullptr;
+
+    // Shadow stack of guest calls, kept by both interpreter and compiled code
+    std::array<ReturnAddress, RETURN_STACK_SIZE> return_stack_ = {};
+    uint64_t return_stack_top_ = 0;
+    const void *slow_path_return_address_ = nullptr;
+    uint64_t instr_count_ = 0;
+    // Compiled code takes process specific addresses from here
+    uint8_t *raw_memory_ = nullptr;
+    const compiler::RuntimeHelpers *helpers_ = nullptr;
     std::array<RegValue, RegisterType::REGISTER_COUNT> regs_ = {};
     std::array<RegValue, CSR_COUNT> csrRegs_ = {};
 
@@ -106,6 +250,11 @@ private:
 
     std::mutex bb_cache_lock_;
     BBCache<BB_CACHE_CAPACITY> bbCache_;
+    BBCache<TRACE_CACHE_CAPACITY> traceCache_;
+
+    TraceRecorder traceRecorder_;
+    // Entrypoint of previously executed block, jumps to lower address are loop back edges
+    BasicBlock::Entrypoint lastEntrypoint_ = 0;
 
     Decoder decoder_;
     Dispatcher dispatcher_;
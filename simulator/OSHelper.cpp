@@ -63,6 +63,12 @@ bool OSHelper::loadElfFile(Hart &hart, const std::string &filename) {
         return false;
     }
 
+    ProgramText text;
+    text.entrypoints.push_back(ehdr.e_entry);
+
+    // Identifies program text for the persistent JIT cache
+    uint64_t programHash = compiler::PersistentCache::hash(&ehdr.e_entry, sizeof(ehdr.e_entry));
+
     for (size_t i = 0; i < ehdr.e_phnum; ++i) {
         GElf_Phdr phdr;
         gelf_getphdr(elf, i, &phdr);
@@ -86,6 +92,10 @@ bool OSHelper::loadElfFile(Hart &hart, const std::string &filename) {
         }
         if (phdr.p_flags & PF_X) {
             request |= MemoryRequestBits::X;
+            text.ranges.emplace_back(segmentStart, segmentStart + phdr.p_filesz);
+            programHash = compiler::PersistentCache::hash(&phdr.p_vaddr, sizeof(phdr.p_vaddr), programHash);
+            programHash = compiler::PersistentCache::hash((uint8_t *)fileBuffer + phdr.p_offset, phdr.p_filesz,
+                                                          programHash);
         }
 
         // Explicitly allocate memory for those since we must take into account situation: p_memsze != p_filesz
@@ -99,12 +109,32 @@ bool OSHelper::loadElfFile(Hart &hart, const std::string &filename) {
         }
     }
 
+    // Function symbols give roots for ahead-of-time translation which are reached only by indirect jumps
+    Elf_Scn *scn = nullptr;
+    while ((scn = elf_nextscn(elf, scn)) != nullptr) {
+        GElf_Shdr shdr;
+        if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB || shdr.sh_entsize == 0) {
+            continue;
+        }
+
+        Elf_Data *data = elf_getdata(scn, nullptr);
+        const size_t symbolsCount = shdr.sh_size / shdr.sh_entsize;
+        for (size_t i = 0; data != nullptr && i < symbolsCount; ++i) {
+            GElf_Sym sym;
+            if (gelf_getsym(data, i, &sym) && GELF_ST_TYPE(sym.st_info) == STT_FUNC && sym.st_value != 0) {
+                text.entrypoints.push_back(sym.st_value);
+            }
+        }
+    }
+
     munmap(fileBuffer, fileStat.st_size);
     elf_end(elf);
     close(fd);
 
     heapEnd_ = heapEnd_ + (sizeof(uint64_t) - heapEnd_ & (sizeof(uint64_t) - 1));
     hart.setPC(ehdr.e_entry);
+    hart.openPersistentCache(programHash);
+    hart.translateAheadOfTime(text);
     return true;
 }
 
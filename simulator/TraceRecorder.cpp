@@ -0,0 +1,57 @@
+#include "simulator/TraceRecorder.h"
+
+#include <utility>
+
+namespace RISCV {
+
+void TraceRecorder::start(BasicBlock::Entrypoint head) {
+    ASSERT(!is_recording_);
+    is_recording_ = true;
+    blocks_count_ = 0;
+    trace_ = Trace{};
+    trace_.entrypoint = head;
+}
+
+bool TraceRecorder::append(const BasicBlock &bb, memory::VirtAddr nextPC) {
+    ASSERT(is_recording_);
+
+    // Path went into another trace or did not start from head at all
+    if (bb.isTrace() || (blocks_count_ == 0 && bb.getEntrypoint() != trace_.entrypoint)) {
+        return true;
+    }
+
+    const size_t instrCount = bb.getInstrCount();
+    if (trace_.pcs.size() + instrCount > MAX_SIZE) {
+        return true;
+    }
+
+    const auto body = bb.getBody();
+    for (size_t i = 0; i < instrCount; ++i) {
+        trace_.body.push_back(body[i]);
+        trace_.pcs.push_back(bb.getEntrypoint() + INSTRUCTION_BYTESIZE * i);
+    }
+    ++blocks_count_;
+
+    // Targets of indirect jumps and syscalls are not known in advance, so they can not be guarded
+    const auto lastType = body[instrCount - 1].type;
+    if (lastType == InstructionType::JALR || lastType == InstructionType::ECALL) {
+        return true;
+    }
+
+    // Either loop is closed or path jumped back into some other loop
+    return nextPC <= bb.getEntrypoint() || nextPC == trace_.entrypoint;
+}
+
+std::optional<Trace> TraceRecorder::finish() {
+    ASSERT(is_recording_);
+    is_recording_ = false;
+
+    if (blocks_count_ < 2) {
+        return std::nullopt;
+    }
+
+    trace_.body.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+    return std::move(trace_);
+}
+
+}  // namespace RISCV
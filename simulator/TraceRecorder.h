@@ -0,0 +1,49 @@
+#ifndef INCLUDE_TRACE_RECORDER_H
+#define INCLUDE_TRACE_RECORDER_H
+
+#include <optional>
+#include <vector>
+
+#include "simulator/BasicBlock.h"
+#include "simulator/memory/Memory.h"
+
+namespace RISCV {
+
+// Hot path through several basic blocks which is compiled as a single unit
+struct Trace {
+    BasicBlock::Body body;
+    // Guest PC of every instruction in body except BASIC_BLOCK_END
+    std::vector<BasicBlock::Entrypoint> pcs;
+    BasicBlock::Entrypoint entrypoint;
+};
+
+// Records blocks executed one by one starting from trace head until the path closes or becomes too long
+class TraceRecorder {
+public:
+    static constexpr size_t MAX_SIZE = 64;
+
+    ALWAYS_INLINE bool isRecording() const {
+        return is_recording_;
+    }
+
+    void start(BasicBlock::Entrypoint head);
+
+    // Returns true when recording is over, nextPC is the address control went to after bb
+    bool append(const BasicBlock &bb, memory::VirtAddr nextPC);
+
+    // Trace is dropped if it does not cross block boundary
+    std::optional<Trace> finish();
+
+    static size_t getOffsetToIsRecording() {
+        return MEMBER_OFFSET(TraceRecorder, is_recording_);
+    }
+
+private:
+    bool is_recording_ = false;
+    size_t blocks_count_ = 0;
+    Trace trace_;
+};
+
+}  // namespace RISCV
+
+#endif  // INCLUDE_TRACE_RECORDER_H
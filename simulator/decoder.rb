@@ -29,9 +29,33 @@ def parse_isa_file(isa_filename)
   yaml_file = File.read(isa_filename)
   yaml_data = YAML.safe_load(yaml_file, aliases: true)
   json_data = JSON.parse(yaml_data.to_json, object_class: OpenStruct)
-  return json_data.fields, json_data.instructions, json_data.decodertree
+  return json_data.fields, json_data.instructions, json_data.decodertree, json_data.superinstructions || [],
+         json_data.specializations || []
 end
 
+def get_superinstruction_name(pair)
+  return pair.map { |mnemonic| mnemonic.gsub('.', '').upcase }.join('_')
+end
+
+def get_specialization_name(specialization)
+  return specialization.name.upcase
+end
+
+# Immediates of these instructions are sign extended, others are not decoded
+SEXT_INSTRUCTIONS = ["lui", "auipc", "jal", "jalr", "beq", "bne", "blt","bge",
+                     "bltu", "bgeu", "lb", "lh", "lw", "ld", "lbu", "lhu", "lwu",
+                     "sb", "sh", "sw", "sd", "addi", "xori", "ori", "andi", "addiw",
+                     "slti", "sltiu"]
+
+# Table decoder covers instructions told apart by opcode, funct3 and bits 30 and 25 of funct7, which are all of
+# RV64IM. Other funct7 bits of such instructions are zero
+OPCODE_MASK = 0x7f
+FUNCT3_MASK = 0x7000
+FUNCT7_MASK = 0xfe000000
+FUNCT7_KEY_MASK = 0x21
+FUNCT7_ZERO_MASK = 0x5e
+TABLE_FIELDS = ["rd", "rs1", "rs2", "imm12", "imm20", "jimm20", "storeimm", "bimm", "shamt", "shamtw"]
+
 class DecoderGenerator
   def initialize(gen_dirr)
     @gen_dir = gen_dirr
@@ -135,38 +159,99 @@ EOT
     return instr_type
   end
 
-  def generate_instruction_fields(instruction)
-    instr_field = String.new
-    sext_instructions = ["lui", "auipc", "jal", "jalr", "beq", "bne", "blt","bge",
-                         "bltu", "bgeu", "lb", "lh", "lw", "ld", "lbu", "lhu", "lwu",
-                         "sb", "sh", "sw", "sd", "addi", "xori", "ori", "andi", "addiw",
-                         "slti", "sltiu"]
+  def generate_superinstruction_type(superinstructions)
+    instr_type = String.new
+    for pair in superinstructions
+      instr_type << " "*4 + get_superinstruction_name(pair) + ",\n"
+    end
+    return instr_type
+  end
+
+  def generate_superinstruction_fuse(superinstructions)
+    fuse = String.new
+    for pair in superinstructions
+      first, second = pair.map { |mnemonic| mnemonic.gsub('.', '').upcase }
+      fuse << " "*4 + "if (first == InstructionType::#{first} && second == InstructionType::#{second}) {\n" +
+              " "*8 + "return InstructionType::#{get_superinstruction_name(pair)};\n" +
+              " "*4 + "}\n"
+    end
+    return fuse
+  end
+
+  def generate_specialization_type(specializations)
+    instr_type = String.new
+    for specialization in specializations
+      instr_type << " "*4 + get_specialization_name(specialization) + ",\n"
+    end
+    return instr_type
+  end
+
+  def generate_original_instruction(superinstructions, specializations)
+    original = String.new
+    for pair in superinstructions
+      original << " "*8 + "case InstructionType::#{get_superinstruction_name(pair)}:\n" +
+                  " "*12 + "return InstructionType::#{pair[0].gsub('.', '').upcase};\n"
+    end
+    for specialization in specializations
+      original << " "*8 + "case InstructionType::#{get_specialization_name(specialization)}:\n" +
+                  " "*12 + "return InstructionType::#{specialization.instruction.gsub('.', '').upcase};\n"
+    end
+    return original
+  end
+
+  def generate_operand_condition(field, value)
+    return field == "imm" ? "decInstr.imm == #{value}" : "decInstr.#{field} == RegisterType::#{value.upcase}"
+  end
 
+  def generate_specialization_condition(specialization)
+    conditions = Array.new
+    for field in ["rd", "rs1", "rs2", "imm"]
+      unless specialization[field].nil?
+        conditions << generate_operand_condition(field, specialization[field])
+      end
+    end
+    return conditions.join(" && ")
+  end
+
+  def generate_instruction_specializations(instruction, specializations)
+    specialized = String.new
+    for specialization in specializations.select { |spec| spec.instruction == instruction.mnemonic }
+      specialized << (specialized.empty? ? " "*8 + "if" : " else if")
+      specialized << " (#{generate_specialization_condition(specialization)}) {\n" +
+                     " "*12 + "decInstr.type = InstructionType::#{get_specialization_name(specialization)};\n" +
+                     " "*8 + "}"
+    end
+    return specialized.empty? ? specialized : specialized + "\n"
+  end
+
+  def generate_instruction_fields(instruction, specializations)
+    instr_field = String.new
     for field in instruction.fields
       field_name = field
       if field_name.include? 'imm'
         field_name = 'imm'
-        if sext_instructions.include? instruction.mnemonic
+        if SEXT_INSTRUCTIONS.include? instruction.mnemonic
           instr_field << " "*8 + "decInstr.#{field_name} = " \
                          "sext<#{field.capitalize}::SIGNEDBIT>(#{field.capitalize}::getValue(encInstr));\n"
         end
-      elsif
+      else
         instr_field << " "*8 + "decInstr.#{field_name} = " \
                        "#{field.capitalize}::getValue(encInstr);\n"
       end
     end
+    instr_field << generate_instruction_specializations(instruction, specializations)
     instr_field << " "*8 + "return decInstr;"
     return instr_field
   end
 
-  def generate_instruction_class(instruction)
+  def generate_instruction_class(instruction, specializations)
     instr_class = <<-EOT
 struct Instruction#{instruction.mnemonic.upcase} {
     static constexpr uint32_t OPCODE = #{instruction.fixedvalue};
     static inline DecodedInstruction decodeInstruction(EncodedInstruction encInstr) {
-        DecodedInstruction decInstr;
+        DecodedInstruction decInstr{};
         decInstr.type = InstructionType::#{instruction.mnemonic.upcase};
-#{generate_instruction_fields(instruction)}
+#{generate_instruction_fields(instruction, specializations)}
     }
 };
 
@@ -174,15 +259,15 @@ EOT
     return instr_class
   end
 
-  def generate_instruction(instructions)
+  def generate_instruction(instructions, specializations)
     instr = String.new
     for instruction in instructions
-      instr << generate_instruction_class(instruction)
+      instr << generate_instruction_class(instruction, specializations)
     end
     return instr.chop!
   end
 
-  def generate_instruction_classes(instructions)
+  def generate_instruction_classes(instructions, specializations)
     instructions_file = File.new(@gen_dir + '/Instructions.h', 'w') 
     instr_enum = <<-EOT
 #ifndef GENERATED_INSTRUCTIONS_H
@@ -195,7 +280,7 @@ EOT
 
 namespace RISCV {
 
-#{generate_instruction(instructions)}
+#{generate_instruction(instructions, specializations)}
 }  // namespace RISCV
 
 #endif  // GENERATED_INSTRUCTIONS_H
@@ -205,7 +290,7 @@ EOT
     instructions_file.close
   end
 
-  def generate_instruction_types(instructions)
+  def generate_instruction_types(instructions, superinstructions, specializations)
     instructions_file = File.new(@gen_dir + '/InstructionTypes.h', 'w') 
     instr_enum = <<-EOT
 #ifndef GENERATED_INSTRUCTION_TYPES_H
@@ -220,9 +305,32 @@ enum InstructionType : uint8_t {
     INSTRUCTION_COUNT,
 
     BASIC_BLOCK_END = INSTRUCTION_COUNT,
-    INSTRUCTION_INVALID = INSTRUCTION_COUNT
+    INSTRUCTION_INVALID = INSTRUCTION_COUNT,
+
+    // Superinstruction takes place of the first instruction of fused pair, the second one stays in the next slot.
+    // Only interpreter sees them
+#{generate_superinstruction_type(superinstructions)}
+    // Instructions decoded with particular operands, they behave exactly as the original one
+#{generate_specialization_type(specializations)}
+    DISPATCH_COUNT
 };
 
+// Returns INSTRUCTION_INVALID if the pair is not fused
+static inline InstructionType getSuperinstruction(InstructionType first, InstructionType second) {
+#{generate_superinstruction_fuse(superinstructions)}
+    return InstructionType::INSTRUCTION_INVALID;
+}
+
+// Original type of the first instruction of superinstruction or of specialized instruction, other types are
+// returned as is
+static inline InstructionType getOriginalInstruction(InstructionType type) {
+    switch (type) {
+#{generate_original_instruction(superinstructions, specializations)}
+        default:
+            return type;
+    }
+}
+
 }  // namespace RISCV
 
 #endif  // GENERATED_INSTRUCTION_TYPES_H
@@ -232,9 +340,9 @@ EOT
     instructions_file.close
   end
 
-  def generate_instructions(instructions)
-    generate_instruction_types(instructions)
-    generate_instruction_classes(instructions)
+  def generate_instructions(instructions, superinstructions, specializations)
+    generate_instruction_types(instructions, superinstructions, specializations)
+    generate_instruction_classes(instructions, specializations)
   end
 
   def get_instruction_opcode(low, high)
@@ -265,7 +373,7 @@ EOT
       end
     end
     decoder_switch << " "*(whitespace + 4) + "default:\n" +
-                      " "*(whitespace + 8) + "UNREACHABLE();\n"
+                      " "*(whitespace + 8) + "return DecodedInstruction{};\n"
     decoder_switch << " "*whitespace + "}\n"
     return decoder_switch
   end
@@ -274,21 +382,313 @@ EOT
     return generate_decoder_switch(decodertree, 4).chop!
   end
 
-  def generate_decoder(decodertree)
+  def get_immediate_field(instruction)
+    return instruction.fields.find { |field| !["rd", "rs1", "rs2"].include? field }
+  end
+
+  def is_table_decodable(instruction)
+    mask = instruction.fixedmask
+    funct7_mask = (mask >> 25) & 0x7f
+    funct7 = (instruction.fixedvalue >> 25) & 0x7f
+    if (mask & OPCODE_MASK) != OPCODE_MASK || (mask & ~(OPCODE_MASK | FUNCT3_MASK | FUNCT7_MASK)) != 0
+      return false
+    end
+    if funct7_mask != 0 && ((funct7_mask & FUNCT7_ZERO_MASK) != FUNCT7_ZERO_MASK || (funct7 & FUNCT7_ZERO_MASK) != 0)
+      return false
+    end
+    unless instruction.fields.all? { |field| TABLE_FIELDS.include? field }
+      return false
+    end
+    return SEXT_INSTRUCTIONS.include?(instruction.mnemonic) || instruction.fields.none? { |field| field.include? 'imm' }
+  end
+
+  # Row of the table holds instructions indexed by funct7 key, nil entries are left to decoder tree. Slot of opcode and
+  # funct3 gets a row only if every instruction which may be encoded there is covered
+  def build_decoder_rows(instructions)
+    rows = Array.new(128 * 8)
+    rows.each_index do |index|
+      opcode = index >> 3
+      funct3 = (index & 0x7) << 12
+      slot_instrs = instructions.select do |instr|
+        ((opcode ^ instr.fixedvalue) & instr.fixedmask & OPCODE_MASK) == 0 &&
+          ((funct3 ^ instr.fixedvalue) & instr.fixedmask & FUNCT3_MASK) == 0
+      end
+      if slot_instrs.empty? || !slot_instrs.all? { |instr| is_table_decodable(instr) }
+        next
+      end
+
+      by_funct7 = slot_instrs.select { |instr| (instr.fixedmask & FUNCT7_MASK) != 0 }
+      if by_funct7.empty?
+        rows[index] = Array.new(4, [slot_instrs[0], false]) if slot_instrs.size == 1
+      elsif by_funct7.size == slot_instrs.size
+        rows[index] = (0...4).map do |key|
+          funct7_key = ((key >> 1) << 5) | (key & 1)
+          matching = slot_instrs.select do |instr|
+            ((funct7_key ^ (instr.fixedvalue >> 25)) & (instr.fixedmask >> 25) & FUNCT7_KEY_MASK) == 0
+          end
+          matching.size == 1 ? [matching[0], true] : nil
+        end
+      end
+    end
+    return rows
+  end
+
+  def get_table_immediates(rows)
+    immediates = Array.new
+    for row in rows.compact
+      for instr, _ in row.compact
+        field = get_immediate_field(instr)
+        immediates << field unless field.nil? || immediates.include?(field)
+      end
+    end
+    return immediates
+  end
+
+  def generate_immediate_enum(immediates)
+    return immediates.map { |field| " "*4 + field.upcase + ",\n" }.join.chop!
+  end
+
+  def generate_immediate_values(immediates)
+    values = immediates.map do |field|
+      value = "#{field.capitalize}::getValue(encInstr)"
+      if field.include? 'imm'
+        value = "sextImmediate<#{field.capitalize}::SIGNEDBIT>(#{value})"
+      else
+        value = "static_cast<int32_t>(#{value})"
+      end
+      " "*8 + "#{value},\n"
+    end
+    return values.join.chop!
+  end
+
+  # Row 0 of specialized types is left for instructions without specializations
+  def get_specialization_row(mnemonic, specializations)
+    row = specializations.map { |spec| spec.instruction }.uniq.index(mnemonic)
+    return row.nil? ? 0 : row + 1
+  end
+
+  def generate_table_entry(entry, specializations)
+    if entry.nil?
+      return "{}"
+    end
+    instr, checks_funct7 = entry
+    registers = ["rd", "rs1", "rs2"].select { |field| instr.fields.include? field }
+    registers = registers.map { |field| "#{field.capitalize}::MASK" }
+    immediate = get_immediate_field(instr)
+    immediate = immediate.nil? ? "NO_IMMEDIATE" : immediate.upcase
+    return "{InstructionType::#{instr.mnemonic.upcase}, DecoderImmediate::#{immediate}, " \
+           "#{get_specialization_row(instr.mnemonic, specializations)}, #{checks_funct7}, " \
+           "#{registers.empty? ? '0' : registers.join(' | ')}}"
+  end
+
+  # Operands specializations compare, each one is a bit of condition mask
+  def get_specialization_conditions(specializations)
+    conditions = Array.new
+    for specialization in specializations
+      for field in ["rd", "rs1", "rs2", "imm"]
+        condition = [field, specialization[field]]
+        conditions << condition unless condition[1].nil? || conditions.include?(condition)
+      end
+    end
+    return conditions
+  end
+
+  def get_condition_name(condition)
+    return "#{condition[0]}_IS_#{condition[1]}".upcase
+  end
+
+  def generate_condition_enum(conditions)
+    values = conditions.each_with_index.map do |condition, bit|
+      " "*4 + "#{get_condition_name(condition)} = 1 << #{bit},\n"
+    end
+    return values.join.chop!
+  end
+
+  def generate_condition_mask(conditions)
+    masks = conditions.map do |condition|
+      "(#{generate_operand_condition(*condition)}) * #{get_condition_name(condition)}"
+    end
+    return masks.join(" |\n" + " "*32)
+  end
+
+  def generate_specialization_rules(specializations, conditions)
+    rules = specializations.map do |specialization|
+      mask = conditions.select { |field, value| specialization[field] == value }
+      mask = mask.map { |condition| get_condition_name(condition) }
+      " "*4 + "{#{get_specialization_row(specialization.instruction, specializations)}, #{mask.join(' | ')}, " \
+        "InstructionType::#{get_specialization_name(specialization)}},\n"
+    end
+    return rules.join.chop!
+  end
+
+  def generate_decoder_tables(rows, specializations)
+    row_entries = [" "*4 + "{{}, {}, {}, {}},\n"]
+    row_indices = Hash.new
+    row_map = String.new
+    rows.each_slice(8).with_index do |slots, opcode|
+      indices = slots.map do |row|
+        next 0 if row.nil?
+        text = " "*4 + "{\n" + row.map { |entry| " "*8 + generate_table_entry(entry, specializations) + ",\n" }.join +
+               " "*4 + "},\n"
+        row_indices[text] ||= (row_entries << text).size - 1
+      end
+      row_map << " "*4 + indices.join(", ") + ",  // opcode 0x#{opcode.to_s(16)}\n"
+    end
+    return row_entries.join.chop!, row_entries.size, row_map.chop!
+  end
+
+  def generate_decoder(decodertree, instructions, specializations)
     decoder_file = File.new(@gen_dir + '/Decoder.cpp', 'w') 
+    decoder_rows = build_decoder_rows(instructions)
+    immediates = get_table_immediates(decoder_rows)
+    row_entries, row_count, row_map = generate_decoder_tables(decoder_rows, specializations)
+    conditions = get_specialization_conditions(specializations)
     decode_method = <<-EOT
+#include <array>
+
 #include "simulator/Decoder.h"
 #include "utils/macros.h"
 #include "generated/Instructions.h"
 
 namespace RISCV {
 
-DecodedInstruction Decoder::decodeInstruction(const EncodedInstruction encInstr) const {
-    DecodedInstruction decInstr;
+// Immediate field of instruction, decoder extracts all of them and picks the one instruction has
+enum class DecoderImmediate : uint8_t {
+    NO_IMMEDIATE,
+#{generate_immediate_enum(immediates)}
+};
+
+// Type of instruction and how to extract its fields
+struct DecoderEntry {
+    // INSTRUCTION_INVALID sends decoding to decoder tree
+    InstructionType type = InstructionType::INSTRUCTION_INVALID;
+    DecoderImmediate immediate = DecoderImmediate::NO_IMMEDIATE;
+    // Row of specialized types
+    uint8_t specialization = 0;
+    // funct7 bits other than the key ones are zero
+    bool checksFunct7 = false;
+    // Register fields instruction has, absent ones are decoded as zero
+    uint32_t registerMask = 0;
+};
+
+// Instructions sharing opcode and funct3 indexed by funct7 key, row 0 is left to decoder tree
+static constexpr DecoderEntry DECODER_ROWS[#{row_count}][4] = {
+#{row_entries}
+};
+
+// Row of instructions indexed by opcode and funct3
+static constexpr uint8_t DECODER_ROW_MAP[128 * 8] = {
+#{row_map}
+};
+
+// Operands compared by specializations
+enum DecoderCondition : uint8_t {
+#{generate_condition_enum(conditions)}
+};
+
+// Instruction gets specialized type if its operands meet all the conditions, rules listed first take priority
+struct SpecializationRule {
+    uint8_t row;
+    uint8_t conditions;
+    InstructionType type;
+};
+
+static constexpr SpecializationRule SPECIALIZATION_RULES[] = {
+#{generate_specialization_rules(specializations, conditions)}
+};
+
+static constexpr size_t CONDITION_MASK_COUNT = 1 << #{conditions.size};
+static constexpr size_t SPECIALIZATION_ROW_COUNT = #{specializations.map { |spec| spec.instruction }.uniq.size + 1};
+using SpecializedTypes = std::array<std::array<InstructionType, CONDITION_MASK_COUNT>, SPECIALIZATION_ROW_COUNT>;
+
+// Specialized type by row and mask of met conditions, INSTRUCTION_INVALID keeps the decoded type
+static constexpr SpecializedTypes makeSpecializedTypes() {
+    SpecializedTypes specializedTypes{};
+    for (auto &row : specializedTypes) {
+        for (auto &type : row) {
+            type = InstructionType::INSTRUCTION_INVALID;
+        }
+    }
+    for (size_t rule = std::size(SPECIALIZATION_RULES); rule-- > 0;) {
+        const SpecializationRule &specialization = SPECIALIZATION_RULES[rule];
+        for (size_t mask = 0; mask < CONDITION_MASK_COUNT; ++mask) {
+            if ((mask & specialization.conditions) == specialization.conditions) {
+                specializedTypes[specialization.row][mask] = specialization.type;
+            }
+        }
+    }
+    return specializedTypes;
+}
+
+static constexpr SpecializedTypes SPECIALIZED_TYPES = makeSpecializedTypes();
+
+static constexpr uint32_t FUNCT7_ZERO_MASK = 0x#{(FUNCT7_ZERO_MASK << 25).to_s(16)};
+
+static ALWAYS_INLINE uint32_t getDecoderRowIndex(const EncodedInstruction encInstr) {
+    return (getPartialBitsShifted<0, 6>(encInstr) << 3) | getPartialBitsShifted<12, 14>(encInstr);
+}
+
+// Unlike sext it does not branch on sign, immediates fit in 32 bits
+template <uint8_t signBitNum>
+static ALWAYS_INLINE int32_t sextImmediate(const uint32_t val) {
+    constexpr uint32_t shift = 31 - signBitNum;
+    return static_cast<int32_t>(val << shift) >> shift;
+}
+
+// funct7 bits 5 and 0 tell apart RV64IM instructions sharing opcode and funct3
+static ALWAYS_INLINE uint32_t getFunct7Key(const EncodedInstruction encInstr) {
+    return (getPartialBitsShifted<30, 30>(encInstr) << 1) | getPartialBitsShifted<25, 25>(encInstr);
+}
+
+// Decoder tree, unknown encoding gets INSTRUCTION_INVALID type
+static DecodedInstruction decodeByTree(const EncodedInstruction encInstr) {
 #{generate_decoder_body(decodertree)}
     UNREACHABLE();
 }
 
+static ALWAYS_INLINE DecodedInstruction decodeByTable(const EncodedInstruction encInstr) {
+    const DecoderEntry &entry = DECODER_ROWS[DECODER_ROW_MAP[getDecoderRowIndex(encInstr)]][getFunct7Key(encInstr)];
+    const uint32_t zeroMask = FUNCT7_ZERO_MASK * entry.checksFunct7;
+    // Both checks are evaluated, so common instructions take a single well predicted branch
+    if (UNLIKELY((entry.type == InstructionType::INSTRUCTION_INVALID) | ((encInstr & zeroMask) != 0))) {
+        return decodeByTree(encInstr);
+    }
+
+    const int32_t immediates[] = {
+        0,
+#{generate_immediate_values(immediates)}
+    };
+
+    DecodedInstruction decInstr{};
+    decInstr.imm = immediates[static_cast<uint8_t>(entry.immediate)];
+    const EncodedInstruction registers = encInstr & entry.registerMask;
+    decInstr.rd = Rd::getValue(registers);
+    decInstr.rs1 = Rs1::getValue(registers);
+    decInstr.rs2 = Rs2::getValue(registers);
+
+    // Conditions are checked for every instruction, so specialization does not branch
+    const uint32_t conditions = #{generate_condition_mask(conditions)};
+    const InstructionType specialized = SPECIALIZED_TYPES[entry.specialization][conditions];
+    decInstr.type = specialized != InstructionType::INSTRUCTION_INVALID ? specialized : entry.type;
+    return decInstr;
+}
+
+DecodedInstruction Decoder::decodeInstruction(const EncodedInstruction encInstr) const {
+    const DecodedInstruction decInstr = decodeByTable(encInstr);
+    if (UNLIKELY(decInstr.type == InstructionType::INSTRUCTION_INVALID)) {
+        UNREACHABLE();
+    }
+    return decInstr;
+}
+
+DecodedInstruction Decoder::tryDecodeInstruction(const EncodedInstruction encInstr) const {
+    return decodeByTable(encInstr);
+}
+
+DecodedInstruction Decoder::decodeInstructionByTree(const EncodedInstruction encInstr) const {
+    return decodeByTree(encInstr);
+}
+
 }  // namespace RISCV
 EOT
     decoder_file.write(decode_method)
@@ -296,17 +696,17 @@ EOT
   end
 end
 
-def generate_decoder(gen_dir, fields, instructions, decodertree)
+def generate_decoder(gen_dir, fields, instructions, decodertree, superinstructions, specializations)
   decoder_gen = DecoderGenerator.new(gen_dir)
   decoder_gen.generate_fields(fields)
-  decoder_gen.generate_instructions(instructions)
-  decoder_gen.generate_decoder(decodertree)
+  decoder_gen.generate_instructions(instructions, superinstructions, specializations)
+  decoder_gen.generate_decoder(decodertree, instructions, specializations)
 end
 
 def main
   options = parse_argv()
-  fields, instructions, decodertree = parse_isa_file(options.isa)
-  generate_decoder(options.gen_dir, fields, instructions, decodertree)
+  fields, instructions, decodertree, superinstructions, specializations = parse_isa_file(options.isa)
+  generate_decoder(options.gen_dir, fields, instructions, decodertree, superinstructions, specializations)
 end
 
 main()
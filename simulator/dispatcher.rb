@@ -29,7 +29,15 @@ def parse_isa_file(isa_filename)
   yaml_file = File.read(isa_filename)
   yaml_data = YAML.safe_load(yaml_file, aliases: true)
   json_data = JSON.parse(yaml_data.to_json, object_class: OpenStruct)
-  return json_data.instructions
+  return json_data.instructions, json_data.superinstructions || [], json_data.specializations || []
+end
+
+def get_superinstruction_name(pair)
+  return pair.map { |mnemonic| mnemonic.gsub('.', '').upcase }.join('_')
+end
+
+def get_specialization_name(specialization)
+  return specialization.name.upcase
 end
 
 class DispatcherGenerator
@@ -40,34 +48,44 @@ class DispatcherGenerator
       end
     end
 
-    def generate_dispatch_table_case(instructions)
+    def generate_dispatch_table_case(instructions, superinstructions, specializations)
+      labels = instructions.map { |instruction| instruction.mnemonic.gsub!('.', '') || instruction.mnemonic }
+      labels = labels.map(&:upcase)
+      # Indices of superinstructions and specialized instructions follow BASIC_BLOCK_END
+      labels << "BASIC_BLOCK_END"
+      labels += superinstructions.map { |pair| get_superinstruction_name(pair) }
+      labels += specializations.map { |specialization| get_specialization_name(specialization) }
+
       dispatch_table_case = String.new
       instr_cnt = 0
       new_line_offset = 38
-      for instruction in instructions
-        instruction.mnemonic.gsub! '.', ""
-        dispatch_table_case << "&&#{instruction.mnemonic.upcase}"
+      labels.each_with_index do |label, index|
+        dispatch_table_case << "&&#{label}"
+        if index == labels.size - 1
+          break
+        end
         dispatch_table_case << ","
-        dispatch_table_case << " "*(11 - instruction.mnemonic.length)
+        dispatch_table_case << " "*[11 - label.length, 1].max
         instr_cnt += 1
         if instr_cnt == 6
+          dispatch_table_case.rstrip!
           dispatch_table_case << "\n"
           dispatch_table_case << " "*new_line_offset
           instr_cnt = 0
         end
       end
-      dispatch_table_case << "&&BASIC_BLOCK_END"
       return dispatch_table_case
     end
 
-    def generate_dispatch_table(instructions)
+    def generate_dispatch_table(instructions, superinstructions, specializations)
       dispatch_table = <<-EOT
-    static void *dispatch_table[] = { #{generate_dispatch_table_case(instructions)} };
+    static void *dispatch_table[] = { #{generate_dispatch_table_case(instructions, superinstructions, specializations)} };
+    static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) == InstructionType::DISPATCH_COUNT);
 EOT
       return dispatch_table.chop!;
     end
 
-    def generate_dispatch_case(instructions)
+    def generate_dispatch_case(instructions, superinstructions, specializations)
       dispatch_case = String.new
       for instruction in instructions
         instr_name = instruction.mnemonic.upcase;
@@ -78,8 +96,31 @@ EOT
 EOT
       end
 
+      # Both executors are inlined into a single handler, the second instruction is skipped by dispatch
+      for pair in superinstructions
+        first, second = pair.map { |mnemonic| mnemonic.gsub('.', '').upcase }
+        dispatch_case += <<-EOT
+#{get_superinstruction_name(pair)}:
+    Executor#{first}(hart_, instr_iter[0]);
+    Executor#{second}(hart_, instr_iter[1]);
+    ++instr_iter;
+    DISPATCH();
+EOT
+      end
+
+      for specialization in specializations
+        instr_name = get_specialization_name(specialization)
+        dispatch_case += <<-EOT
+#{instr_name}:
+    Executor#{instr_name}(hart_, *instr_iter);
+    DISPATCH();
+EOT
+      end
+
+      # Sentinel carries PC delta of NOPs dropped from the body
       dispatch_case += <<-EOT
 BASIC_BLOCK_END:
+    hart_->setPC(hart_->getPC() + instr_iter->imm);
     return;
 
     UNREACHABLE();
@@ -87,7 +128,15 @@ EOT
       return dispatch_case.chop!
     end
 
-    def generate_dispatcher(instructions)
+    def generate_executor_table(instructions)
+      executor_table = String.new
+      for instruction in instructions
+        executor_table << "        Executor#{instruction.mnemonic.upcase},\n"
+      end
+      return executor_table.chop!
+    end
+
+    def generate_dispatcher(instructions, superinstructions, specializations)
       dispatcher_file = File.new(@gen_dir + '/Dispatcher.cpp', 'w') 
       dispatcher = <<-EOT
 #include "simulator/Dispatcher.h"
@@ -96,15 +145,38 @@ EOT
 namespace RISCV {
 
 void Dispatcher::dispatchExecute(BasicBlock::BodyEntry instr_iter) {
-#{generate_dispatch_table(instructions)}
+#{generate_dispatch_table(instructions, superinstructions, specializations)}
 
+#if defined(RISCV_DIRECT_THREADED)
+    // The first call only publishes addresses of handlers, fetch stores them into decoded instructions
+    if (UNLIKELY(handlers_ == nullptr)) {
+        handlers_ = dispatch_table;
+        return;
+    }
+
+#define DISPATCH()                          \\
+    ++instr_iter;                           \\
+    goto *instr_iter->handler
+
+    goto *instr_iter->handler;
+#else
 #define DISPATCH()                          \\
     ++instr_iter;                           \\
     goto *dispatch_table[instr_iter->type]
 
     goto *dispatch_table[instr_iter->type];
+#endif
+
+#{generate_dispatch_case(instructions, superinstructions, specializations)}
+}
+
+Executor Dispatcher::getExecutor(InstructionType type) {
+    static const Executor executors[] = {
+#{generate_executor_table(instructions)}
+    };
 
-#{generate_dispatch_case(instructions)}
+    ASSERT(type < InstructionType::INSTRUCTION_COUNT);
+    return executors[type];
 }
 
 }  // namespace RISCV
@@ -117,9 +189,9 @@ end
 
 def main
   options = parse_argv()
-  instructions = parse_isa_file(options.isa)
+  instructions, superinstructions, specializations = parse_isa_file(options.isa)
   generator = DispatcherGenerator.new(options.gen_dir)
-  generator.generate_dispatcher(instructions)
+  generator.generate_dispatcher(instructions, superinstructions, specializations)
 end
 
 main()
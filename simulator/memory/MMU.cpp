@@ -4,6 +4,14 @@
 
 namespace RISCV::memory {
 
+size_t TLB::getOffsetToRTLB() {
+    return MEMBER_OFFSET(TLB, rTLB_);
+}
+
+size_t TLB::getOffsetToWTLB() {
+    return MEMBER_OFFSET(TLB, wTLB_);
+}
+
 MMU::MMU() {
     setExceptionHandler(defaultMMUExceptionHandler);
 }
@@ -55,6 +55,12 @@ public:
     static constexpr const size_t rTLB_CACHE_CAPACITY = 2048;
     static constexpr const size_t wTLB_CACHE_CAPACITY = 2048;
 
+    // Every cache is a plain array of (vpn, ppnUnshifted) pairs, compiled code probes it directly
+    using Entry = std::pair<uint64_t, uint64_t>;
+
+    static size_t getOffsetToRTLB();
+    static size_t getOffsetToWTLB();
+
     template <MemoryType type>
     ALWAYS_INLINE std::optional<uint64_t> find(const uint64_t vpn) const {
         if constexpr (type == MemoryType::IMem) {
@@ -85,7 +91,7 @@ private:
         static constexpr const uint64_t checkBits = CAPACITY - 1;
 
         std::optional<uint64_t> find(const uint64_t vpn) const {
-            const std::pair<uint64_t, uint64_t> &vpn_ppn = storage_[vpn & checkBits];
+            const Entry &vpn_ppn = storage_[vpn & checkBits];
             if (LIKELY(vpn_ppn.first == vpn)) {
                 return vpn_ppn.second;
             }
@@ -93,11 +99,11 @@ private:
         }
 
         void insert(const uint64_t vpn, const uint64_t ppnUnshifted) {
-            storage_[vpn & checkBits] = std::pair(vpn, ppnUnshifted);
+            storage_[vpn & checkBits] = Entry(vpn, ppnUnshifted);
         }
 
     private:
-        std::pair<uint64_t, uint64_t> storage_[CAPACITY] = {};
+        Entry storage_[CAPACITY] = {};
     };
 
     // iTLB
@@ -56,6 +56,10 @@ public:
         return true;
     }
 
+    inline uint8_t *getRawMemory() const {
+        return memory_;
+    }
+
     PhysicalMemory();
     ~PhysicalMemory();
 };
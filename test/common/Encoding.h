@@ -0,0 +1,138 @@
+#ifndef INCLUDE_TEST_ENCODING_H_
+#define INCLUDE_TEST_ENCODING_H_
+
+#include <cstdint>
+
+#include "simulator/Common.h"
+#include "simulator/constants.h"
+
+// Encoders of RV64IM instructions, tests build block bodies from them. Immediates are taken as they appear in
+// assembly, offsets of jumps and branches are relative to the instruction
+namespace RISCV::encoding {
+
+static constexpr uint32_t OPCODE_LOAD = 0b0000011;
+static constexpr uint32_t OPCODE_OP_IMM = 0b0010011;
+static constexpr uint32_t OPCODE_AUIPC = 0b0010111;
+static constexpr uint32_t OPCODE_OP_IMM_32 = 0b0011011;
+static constexpr uint32_t OPCODE_STORE = 0b0100011;
+static constexpr uint32_t OPCODE_OP = 0b0110011;
+static constexpr uint32_t OPCODE_LUI = 0b0110111;
+static constexpr uint32_t OPCODE_BRANCH = 0b1100011;
+static constexpr uint32_t OPCODE_JALR = 0b1100111;
+static constexpr uint32_t OPCODE_JAL = 0b1101111;
+static constexpr uint32_t OPCODE_SYSTEM = 0b1110011;
+
+static constexpr uint32_t FUNCT7_MULDIV = 1;
+
+static inline EncodedInstruction encodeR(uint32_t funct7, uint32_t funct3, RegisterType rd, RegisterType rs1,
+                                         RegisterType rs2) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | OPCODE_OP;
+}
+
+static inline EncodedInstruction encodeI(uint32_t opcode, uint32_t funct3, RegisterType rd, RegisterType rs1,
+                                         int32_t imm) {
+    return ((imm & 0xfff) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static inline EncodedInstruction encodeS(uint32_t funct3, RegisterType rs1, RegisterType rs2, int32_t imm) {
+    return (((imm >> 5) & 0x7f) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1f) << 7) |
+           OPCODE_STORE;
+}
+
+static inline EncodedInstruction encodeB(uint32_t funct3, RegisterType rs1, RegisterType rs2, int32_t offset) {
+    return (((offset >> 12) & 1) << 31) | (((offset >> 5) & 0x3f) << 25) | (rs2 << 20) | (rs1 << 15) |
+           (funct3 << 12) | (((offset >> 1) & 0xf) << 8) | (((offset >> 11) & 1) << 7) | OPCODE_BRANCH;
+}
+
+static inline EncodedInstruction lui(RegisterType rd, uint32_t imm) {
+    return (imm << 12) | (rd << 7) | OPCODE_LUI;
+}
+
+static inline EncodedInstruction auipc(RegisterType rd, uint32_t imm) {
+    return (imm << 12) | (rd << 7) | OPCODE_AUIPC;
+}
+
+static inline EncodedInstruction jal(RegisterType rd, int32_t offset) {
+    return (((offset >> 20) & 1) << 31) | (((offset >> 1) & 0x3ff) << 21) | (((offset >> 11) & 1) << 20) |
+           (((offset >> 12) & 0xff) << 12) | (rd << 7) | OPCODE_JAL;
+}
+
+static inline EncodedInstruction jalr(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_JALR, 0b000, rd, rs1, imm);
+}
+
+static inline EncodedInstruction beq(RegisterType rs1, RegisterType rs2, int32_t offset) {
+    return encodeB(0b000, rs1, rs2, offset);
+}
+
+static inline EncodedInstruction bne(RegisterType rs1, RegisterType rs2, int32_t offset) {
+    return encodeB(0b001, rs1, rs2, offset);
+}
+
+static inline EncodedInstruction ld(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_LOAD, 0b011, rd, rs1, imm);
+}
+
+static inline EncodedInstruction sd(RegisterType rs2, RegisterType rs1, int32_t imm) {
+    return encodeS(0b011, rs1, rs2, imm);
+}
+
+static inline EncodedInstruction addi(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_OP_IMM, 0b000, rd, rs1, imm);
+}
+
+static inline EncodedInstruction nop() {
+    return addi(RegisterType::ZERO, RegisterType::ZERO, 0);
+}
+
+static inline EncodedInstruction slli(RegisterType rd, RegisterType rs1, uint32_t shamt) {
+    return encodeI(OPCODE_OP_IMM, 0b001, rd, rs1, shamt);
+}
+
+static inline EncodedInstruction slti(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_OP_IMM, 0b010, rd, rs1, imm);
+}
+
+static inline EncodedInstruction sltiu(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_OP_IMM, 0b011, rd, rs1, imm);
+}
+
+static inline EncodedInstruction addiw(RegisterType rd, RegisterType rs1, int32_t imm) {
+    return encodeI(OPCODE_OP_IMM_32, 0b000, rd, rs1, imm);
+}
+
+static inline EncodedInstruction add(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(0, 0b000, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction slt(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(0, 0b010, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction sltu(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(0, 0b011, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction mul(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(FUNCT7_MULDIV, 0b000, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction div(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(FUNCT7_MULDIV, 0b100, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction divu(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(FUNCT7_MULDIV, 0b101, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction remu(RegisterType rd, RegisterType rs1, RegisterType rs2) {
+    return encodeR(FUNCT7_MULDIV, 0b111, rd, rs1, rs2);
+}
+
+static inline EncodedInstruction ecall() {
+    return OPCODE_SYSTEM;
+}
+
+}  // namespace RISCV::encoding
+
+#endif  // INCLUDE_TEST_ENCODING_H_
@@ -0,0 +1,161 @@
+#include <asmjit/asmjit.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "compiler/CodeCache.h"
+
+using namespace RISCV;
+using namespace RISCV::compiler;
+
+static constexpr size_t MEGABYTE = 1 << 20;
+// Budget of 1 MB is exceeded by the fifth block of this size
+static constexpr size_t BLOCK_SIZE = MEGABYTE / 4;
+
+class CodeCacheTest : public testing::Test {
+public:
+    static constexpr BasicBlock::Entrypoint ENTRYPOINT = 0x10000;
+
+    void TearDown() override {
+        cache_.reset();
+        unsetenv(CodeCache::SIZE_ENV);
+    }
+
+    // Budget is read from environment once, when the cache is created
+    void createCache(const char *budgetMb) {
+        setenv(CodeCache::SIZE_ENV, budgetMb, 1);
+        cache_ = std::make_unique<CodeCache>();
+    }
+
+    static BasicBlock::Entrypoint getEntrypoint(size_t index) {
+        return ENTRYPOINT + index * INSTRUCTION_BYTESIZE;
+    }
+
+    // Code of the given size filled with breakpoints, it is never run
+    CodeCache::CompiledEntry add(BasicBlock::Entrypoint entrypoint, bool isTrace = false, size_t size = BLOCK_SIZE) {
+        asmjit::CodeHolder code;
+        code.init(cache_->getEnvironment(), cache_->getCpuFeatures());
+        asmjit::x86::Assembler assembler(&code);
+        const std::vector<uint8_t> bytes(size, 0xcc);
+        assembler.embed(bytes.data(), bytes.size());
+
+        auto entry = cache_->add(code, entrypoint, isTrace);
+        EXPECT_NE(entry, nullptr);
+        return entry;
+    }
+
+    // Unpinned blocks at consecutive entrypoints, the first one is the least recently used
+    std::vector<CodeCache::CompiledEntry> addInstalled(size_t count) {
+        std::vector<CodeCache::CompiledEntry> entries;
+        for (size_t i = 0; i < count; ++i) {
+            entries.push_back(add(getEntrypoint(i)));
+            cache_->unpin(entries.back());
+        }
+        return entries;
+    }
+
+    std::vector<CodeCache::Victim> collect(const std::set<CodeCache::CompiledEntry> &uninstalled = {}) {
+        auto victims = cache_->collect(
+            [&uninstalled](const CodeCache::Record &record) { return uninstalled.count(record.entry) == 0; });
+        cache_->release(victims);
+        return victims;
+    }
+
+    static std::vector<CodeCache::CompiledEntry> getEntries(const std::vector<CodeCache::Victim> &victims) {
+        std::vector<CodeCache::CompiledEntry> entries;
+        for (const auto &victim : victims) {
+            entries.push_back(victim.entry);
+        }
+        return entries;
+    }
+
+protected:
+    std::unique_ptr<CodeCache> cache_;
+};
+
+TEST_F(CodeCacheTest, BudgetIsTrimmedToThreeQuarters) {
+    createCache("1");
+    ASSERT_EQ(cache_->getBudget(), MEGABYTE);
+
+    auto entries = addInstalled(4);
+    EXPECT_FALSE(cache_->needsCollection());
+    // Lookup makes the first block the most recently used one
+    EXPECT_EQ(cache_->find(getEntrypoint(0)), entries[0]);
+    entries.push_back(add(getEntrypoint(4)));
+    cache_->unpin(entries.back());
+    ASSERT_TRUE(cache_->needsCollection());
+
+    const auto victims = collect();
+    EXPECT_FALSE(cache_->needsCollection());
+    EXPECT_EQ(getEntries(victims), (std::vector{entries[1], entries[2]}));
+    EXPECT_EQ(cache_->getSize(), 3 * BLOCK_SIZE);
+    for (const auto &victim : victims) {
+        EXPECT_FALSE(victim.is_replaced);
+        EXPECT_EQ(victim.replacement, nullptr);
+        EXPECT_EQ(cache_->find(victim.entrypoint), nullptr);
+    }
+    EXPECT_EQ(cache_->find(getEntrypoint(0)), entries[0]);
+}
+
+TEST_F(CodeCacheTest, PinnedCodeIsKept) {
+    createCache("1");
+    const auto pinned = add(getEntrypoint(4));
+    const auto entries = addInstalled(4);
+
+    // The oldest code is being installed by compiler thread, so the next two blocks go
+    const auto victims = collect();
+    EXPECT_EQ(getEntries(victims), (std::vector{entries[0], entries[1]}));
+    EXPECT_EQ(cache_->getSize(), 3 * BLOCK_SIZE);
+    const auto *start = reinterpret_cast<const uint8_t *>(pinned);
+    const auto code = cache_->findCode(start + BLOCK_SIZE / 2);
+    ASSERT_TRUE(code.has_value());
+    EXPECT_EQ(code->first, start);
+    EXPECT_EQ(code->second, BLOCK_SIZE);
+}
+
+TEST_F(CodeCacheTest, ReplacedCodeIsReleasedWithReplacement) {
+    // No budget, only replaced code is collected
+    createCache("0");
+    const auto first = add(ENTRYPOINT, false, 64);
+    cache_->unpin(first);
+    const auto trace = add(ENTRYPOINT, true, 64);
+    cache_->unpin(trace);
+    EXPECT_FALSE(cache_->needsCollection());
+
+    // Replaced code is released while its replacement is still being installed
+    const auto second = add(ENTRYPOINT, false, 64);
+    ASSERT_TRUE(cache_->needsCollection());
+    auto victims = collect();
+    ASSERT_EQ(victims.size(), 1U);
+    EXPECT_EQ(victims[0].entry, first);
+    EXPECT_TRUE(victims[0].is_replaced);
+    EXPECT_FALSE(victims[0].is_trace);
+    EXPECT_EQ(victims[0].replacement, second);
+    EXPECT_EQ(cache_->find(ENTRYPOINT), second);
+    EXPECT_EQ(cache_->getSize(), 2 * 64U);
+
+    // Pinned code waits for compiler thread even if it is replaced, unpin asks for collection again
+    const auto third = add(ENTRYPOINT, false, 64);
+    EXPECT_TRUE(collect().empty());
+    cache_->unpin(second);
+    ASSERT_TRUE(cache_->needsCollection());
+    victims = collect();
+    ASSERT_EQ(victims.size(), 1U);
+    EXPECT_EQ(victims[0].entry, second);
+    EXPECT_EQ(victims[0].replacement, third);
+}
+
+TEST_F(CodeCacheTest, UninstalledCodeIsEvictedFirst) {
+    createCache("1");
+    const auto entries = addInstalled(5);
+
+    // No cached block holds the fourth block, it goes before the least recently used one
+    const auto victims = collect({entries[3]});
+    EXPECT_EQ(getEntries(victims), (std::vector{entries[3], entries[0]}));
+    EXPECT_EQ(cache_->getSize(), 3 * BLOCK_SIZE);
+    EXPECT_EQ(cache_->find(getEntrypoint(3)), nullptr);
+    EXPECT_EQ(cache_->find(getEntrypoint(1)), entries[1]);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <optional>
+
+#include "compiler/IR.h"
+#include "simulator/Decoder.h"
+#include "test/common/Encoding.h"
+
+using namespace RISCV;
+using namespace RISCV::compiler;
+using namespace RISCV::encoding;
+
+class IRTest : public testing::Test {
+public:
+    static constexpr BasicBlock::Entrypoint ENTRYPOINT = 0x10000;
+
+    // Body is what BasicBlock::getBody gives to compiler: original instruction types closed by BASIC_BLOCK_END.
+    // Trace keeps jumps in the middle of the body
+    void build(std::initializer_list<EncodedInstruction> encodings, bool isTrace = false) {
+        BasicBlock::Body body;
+        for (EncodedInstruction encoding : encodings) {
+            auto &instr = body.emplace_back(decoder_.decodeInstruction(encoding));
+            instr.type = getOriginalInstruction(instr.type);
+        }
+        body.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+
+        task_ = CompilerTask{std::move(body), ENTRYPOINT};
+        for (size_t i = 0; isTrace && i < encodings.size(); ++i) {
+            task_.pcs.push_back(ENTRYPOINT + INSTRUCTION_BYTESIZE * i);
+        }
+
+        ir_.emplace(IRBlock::build(task_));
+        ir_->optimize();
+    }
+
+    size_t countLive() const {
+        size_t count = 0;
+        for (const auto &instr : ir_->getInstrs()) {
+            count += instr.opcode != IROpcode::NOP;
+        }
+        return count;
+    }
+
+    // The live instruction built from guest instruction at offset, which writes a register or stays GUEST
+    const IRInstr *findResult(uint32_t offset) const {
+        for (const auto &instr : ir_->getInstrs()) {
+            if (instr.offset == offset && instr.opcode != IROpcode::NOP &&
+                (instr.rd != RegisterType::ZERO || instr.opcode == IROpcode::GUEST)) {
+                return &instr;
+            }
+        }
+        return nullptr;
+    }
+
+    bool isRegRead(RegisterType reg) const {
+        for (const auto &instr : ir_->getInstrs()) {
+            if (instr.opcode == IROpcode::GET_REG && instr.reg == reg) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+protected:
+    Decoder decoder_;
+    CompilerTask task_;
+    std::optional<IRBlock> ir_;
+};
+
+TEST_F(IRTest, LuiAddiFoldToSingleConstant) {
+    build({lui(RegisterType::T0, 0x12345), addi(RegisterType::T0, RegisterType::T0, 0x678)});
+    ASSERT_EQ(countLive(), 1U);
+    auto *result = findResult(1);
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->opcode, IROpcode::CONST);
+    EXPECT_EQ(result->rd, RegisterType::T0);
+    EXPECT_EQ(result->imm, 0x12345678U);
+
+    // Negative ADDI borrows from LUI part
+    build({lui(RegisterType::T0, 0x12345), addi(RegisterType::T0, RegisterType::T0, -1)});
+    ASSERT_EQ(countLive(), 1U);
+    EXPECT_EQ(findResult(1)->imm, 0x12344fffU);
+}
+
+TEST_F(IRTest, WritesToZeroAreRemoved) {
+    build({add(RegisterType::ZERO, RegisterType::T0, RegisterType::T1), lui(RegisterType::ZERO, 5),
+           slli(RegisterType::ZERO, RegisterType::T0, 3), addi(RegisterType::ZERO, RegisterType::ZERO, 0)});
+    EXPECT_EQ(countLive(), 0U);
+    EXPECT_FALSE(isRegRead(RegisterType::T0));
+    EXPECT_FALSE(isRegRead(RegisterType::T1));
+}
+
+TEST_F(IRTest, OverwrittenWriteIsRemoved) {
+    build({addi(RegisterType::A0, RegisterType::T1, 1), addi(RegisterType::A0, RegisterType::T1, 2)});
+    EXPECT_EQ(findResult(0), nullptr);
+    ASSERT_NE(findResult(1), nullptr);
+    EXPECT_EQ(findResult(1)->rd, RegisterType::A0);
+}
+
+TEST_F(IRTest, WriteIsKeptBeforeInstructionLeavingCode) {
+    // Branch and syscall leave compiled code, slow path of memory access may raise an exception
+    for (EncodedInstruction exit : {beq(RegisterType::T2, RegisterType::T3, 8), ecall(),
+                                    ld(RegisterType::T4, RegisterType::T5, 8),
+                                    sd(RegisterType::T4, RegisterType::T5, 8)}) {
+        build({addi(RegisterType::A0, RegisterType::T1, 1), exit, addi(RegisterType::A0, RegisterType::T1, 2)}, true);
+        auto *result = findResult(0);
+        ASSERT_NE(result, nullptr) << exit;
+        EXPECT_EQ(result->opcode, IROpcode::ADD) << exit;
+        EXPECT_EQ(result->rd, RegisterType::A0) << exit;
+        ASSERT_NE(findResult(1), nullptr) << exit;
+        EXPECT_EQ(findResult(1)->opcode, IROpcode::GUEST) << exit;
+    }
+}
+
+TEST_F(IRTest, MulDivByPowerOf2BecomeShifts) {
+    build({lui(RegisterType::T1, 1), mul(RegisterType::T2, RegisterType::T0, RegisterType::T1),
+           mul(RegisterType::T3, RegisterType::T1, RegisterType::T0),
+           divu(RegisterType::T4, RegisterType::T0, RegisterType::T1),
+           remu(RegisterType::T5, RegisterType::T0, RegisterType::T1),
+           div(RegisterType::T6, RegisterType::T0, RegisterType::T1)});
+
+    struct Expected {
+        uint32_t offset;
+        IROpcode opcode;
+        RegisterType rd;
+        uint64_t imm;
+    };
+    for (const auto &expected : {Expected{1, IROpcode::SHL, RegisterType::T2, 12},
+                                 Expected{2, IROpcode::SHL, RegisterType::T3, 12},
+                                 Expected{3, IROpcode::SHR, RegisterType::T4, 12},
+                                 Expected{4, IROpcode::AND, RegisterType::T5, 0xfff}}) {
+        auto *result = findResult(expected.offset);
+        ASSERT_NE(result, nullptr) << expected.offset;
+        EXPECT_EQ(result->opcode, expected.opcode) << expected.offset;
+        EXPECT_EQ(result->rd, expected.rd) << expected.offset;
+        EXPECT_EQ(result->imm, expected.imm) << expected.offset;
+        EXPECT_EQ(result->operands[1], NO_VALUE) << expected.offset;
+        EXPECT_EQ(ir_->getInstr(result->operands[0]).opcode, IROpcode::GET_REG) << expected.offset;
+    }
+
+    // Signed division rounds towards zero, shift would round down
+    auto *result = findResult(5);
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->opcode, IROpcode::GUEST);
+}
+
+TEST_F(IRTest, ReadAfterFoldedMulReusesValue) {
+    build({lui(RegisterType::T0, 3), mul(RegisterType::T1, RegisterType::T0, RegisterType::T0),
+           add(RegisterType::T2, RegisterType::T1, RegisterType::A0)});
+
+    auto *product = findResult(1);
+    ASSERT_NE(product, nullptr);
+    EXPECT_EQ(product->opcode, IROpcode::CONST);
+    EXPECT_EQ(product->rd, RegisterType::T1);
+    EXPECT_EQ(product->imm, 0x3000ULL * 0x3000ULL);
+
+    auto *sum = findResult(2);
+    ASSERT_NE(sum, nullptr);
+    EXPECT_EQ(sum->opcode, IROpcode::ADD);
+    EXPECT_EQ(ir_->getConst(sum->operands[0]), 0x3000ULL * 0x3000ULL);
+    EXPECT_FALSE(isRegRead(RegisterType::T1));
+}
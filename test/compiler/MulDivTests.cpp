@@ -0,0 +1,226 @@
+#include <asmjit/asmjit.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compiler/Codegen.h"
+#include "compiler/IR.h"
+#include "simulator/Decoder.h"
+#include "simulator/Executor-inl.h"
+#include "simulator/Hart.h"
+
+using namespace RISCV;
+using namespace RISCV::compiler;
+
+static constexpr RegisterType RD = RegisterType::A0;
+static constexpr RegisterType RS1 = RegisterType::A1;
+static constexpr RegisterType RS2 = RegisterType::A2;
+
+// rd = rs1 op rs2 from M extension, funct7 is 1 for all of them
+static constexpr EncodedInstruction encodeMulDiv(uint32_t funct3, bool isWord) {
+    const uint32_t opcode = isWord ? 0b0111011 : 0b0110011;
+    return (1U << 25) | (RS2 << 20) | (RS1 << 15) | (funct3 << 12) | (RD << 7) | opcode;
+}
+
+struct MulDivInstr {
+    const char *name;
+    EncodedInstruction encoding;
+    void (*execute)(Hart *, const DecodedInstruction &);
+    void (CodeGenerator::*generate)(const DecodedInstruction &);
+    bool isWord;
+};
+
+static const std::vector<MulDivInstr> MUL_DIV_INSTRS = {
+    {"mul", encodeMulDiv(0b000, false), ExecutorMUL, &CodeGenerator::generateMUL, false},
+    {"mulh", encodeMulDiv(0b001, false), ExecutorMULH, &CodeGenerator::generateMULH, false},
+    {"mulhsu", encodeMulDiv(0b010, false), ExecutorMULHSU, &CodeGenerator::generateMULHSU, false},
+    {"mulhu", encodeMulDiv(0b011, false), ExecutorMULHU, &CodeGenerator::generateMULHU, false},
+    {"div", encodeMulDiv(0b100, false), ExecutorDIV, &CodeGenerator::generateDIV, false},
+    {"divu", encodeMulDiv(0b101, false), ExecutorDIVU, &CodeGenerator::generateDIVU, false},
+    {"rem", encodeMulDiv(0b110, false), ExecutorREM, &CodeGenerator::generateREM, false},
+    {"remu", encodeMulDiv(0b111, false), ExecutorREMU, &CodeGenerator::generateREMU, false},
+    {"mulw", encodeMulDiv(0b000, true), ExecutorMULW, &CodeGenerator::generateMULW, true},
+    {"divw", encodeMulDiv(0b100, true), ExecutorDIVW, &CodeGenerator::generateDIVW, true},
+    {"divuw", encodeMulDiv(0b101, true), ExecutorDIVUW, &CodeGenerator::generateDIVUW, true},
+    {"remw", encodeMulDiv(0b110, true), ExecutorREMW, &CodeGenerator::generateREMW, true},
+    {"remuw", encodeMulDiv(0b111, true), ExecutorREMUW, &CodeGenerator::generateREMUW, true},
+};
+
+// Zero, signs, overflow of both widths and words with garbage in upper half
+static const std::vector<RegValue> OPERANDS = {
+    0,
+    1,
+    2,
+    7,
+    static_cast<RegValue>(-1),
+    static_cast<RegValue>(-2),
+    static_cast<RegValue>(-7),
+    static_cast<RegValue>(INT64_MIN),
+    static_cast<RegValue>(INT64_MAX),
+    static_cast<RegValue>(static_cast<int64_t>(INT32_MIN)),
+    static_cast<RegValue>(INT32_MAX),
+    0x80000000,
+    0xffffffff,
+    0x1234567880000000,
+    0x12345678ffffffff,
+    0xdeadbeefcafebabe,
+};
+
+static const MulDivInstr &findInstr(const char *name) {
+    for (const auto &instr : MUL_DIV_INSTRS) {
+        if (std::string(instr.name) == name) {
+            return instr;
+        }
+    }
+    UNREACHABLE();
+}
+
+class MulDivTest : public testing::Test {
+public:
+    void SetUp() override {
+        hart_ = std::make_unique<Hart>();
+    }
+
+    void TearDown() override {
+        for (auto entry : entries_) {
+            runtime_.release(entry);
+        }
+        entries_.clear();
+        hart_.reset();
+    }
+
+    DecodedInstruction decode(const MulDivInstr &instr) {
+        return decoder_.decodeInstruction(instr.encoding);
+    }
+
+    RegValue interpret(const MulDivInstr &instr, RegValue lhs, RegValue rhs) {
+        hart_->setReg(RS1, lhs);
+        hart_->setReg(RS2, rhs);
+        instr.execute(hart_.get(), decode(instr));
+        return hart_->getReg(RD);
+    }
+
+    // Tier 1 code of a block with the single instruction, it reads operands from hart
+    BasicBlock::CompiledEntry compile(const MulDivInstr &instr) {
+        asmjit::CodeHolder code;
+        code.init(runtime_.environment(), runtime_.cpuFeatures());
+        CodeGenerator codegen(&code);
+        codegen.initialize();
+        codegen.startInstr(0);
+        (codegen.*instr.generate)(decode(instr));
+        codegen.generateUnlinkedExit();
+        codegen.finalize();
+
+        BasicBlock::CompiledEntry entry = nullptr;
+        if (runtime_.add(&entry, &code) != asmjit::kErrorOk) {
+            return nullptr;
+        }
+        entries_.push_back(entry);
+        return entry;
+    }
+
+    RegValue run(BasicBlock::CompiledEntry entry, RegValue lhs, RegValue rhs) {
+        hart_->setReg(RS1, lhs);
+        hart_->setReg(RS2, rhs);
+        BasicBlock bb;
+        entry(hart_.get(), &bb);
+        return hart_->getReg(RD);
+    }
+
+    void expectResult(const char *name, RegValue lhs, RegValue rhs, RegValue expected) {
+        const auto &instr = findInstr(name);
+        EXPECT_EQ(interpret(instr, lhs, rhs), expected) << name << " " << lhs << ", " << rhs;
+
+        auto entry = compile(instr);
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(run(entry, lhs, rhs), expected) << name << " " << lhs << ", " << rhs;
+
+        if (!instr.isWord) {
+            EXPECT_EQ(evaluateMulDiv(decode(instr).type, lhs, rhs), expected) << name << " " << lhs << ", " << rhs;
+        }
+    }
+
+protected:
+    std::unique_ptr<Hart> hart_;
+    Decoder decoder_;
+    asmjit::JitRuntime runtime_;
+    std::vector<BasicBlock::CompiledEntry> entries_;
+};
+
+TEST_F(MulDivTest, CompiledCodeMatchesInterpreter) {
+    for (const auto &instr : MUL_DIV_INSTRS) {
+        auto entry = compile(instr);
+        ASSERT_NE(entry, nullptr) << instr.name;
+        for (RegValue lhs : OPERANDS) {
+            for (RegValue rhs : OPERANDS) {
+                EXPECT_EQ(run(entry, lhs, rhs), interpret(instr, lhs, rhs)) << instr.name << " " << lhs << ", " << rhs;
+            }
+        }
+    }
+}
+
+TEST_F(MulDivTest, ConstantFoldingMatchesInterpreter) {
+    for (const auto &instr : MUL_DIV_INSTRS) {
+        // Word operations are never folded
+        if (instr.isWord) {
+            continue;
+        }
+        const InstructionType type = decode(instr).type;
+        for (RegValue lhs : OPERANDS) {
+            for (RegValue rhs : OPERANDS) {
+                EXPECT_EQ(evaluateMulDiv(type, lhs, rhs), interpret(instr, lhs, rhs))
+                    << instr.name << " " << lhs << ", " << rhs;
+            }
+        }
+    }
+}
+
+TEST_F(MulDivTest, DivisionByZero) {
+    expectResult("div", 42, 0, UINT64_MAX);
+    expectResult("div", static_cast<RegValue>(-42), 0, UINT64_MAX);
+    expectResult("divu", 42, 0, UINT64_MAX);
+    expectResult("rem", static_cast<RegValue>(-42), 0, static_cast<RegValue>(-42));
+    expectResult("remu", 42, 0, 42);
+
+    // Word results are sign extended, upper half of divisor is ignored
+    expectResult("divw", 42, 0x100000000, UINT64_MAX);
+    expectResult("divuw", 42, 0, UINT64_MAX);
+    expectResult("remw", 0x1234567880000000, 0, static_cast<RegValue>(static_cast<int64_t>(INT32_MIN)));
+    expectResult("remuw", 0xffffffff, 0, UINT64_MAX);
+}
+
+TEST_F(MulDivTest, SignedOverflow) {
+    expectResult("div", static_cast<RegValue>(INT64_MIN), static_cast<RegValue>(-1), static_cast<RegValue>(INT64_MIN));
+    expectResult("rem", static_cast<RegValue>(INT64_MIN), static_cast<RegValue>(-1), 0);
+
+    const auto wordMin = static_cast<RegValue>(static_cast<int64_t>(INT32_MIN));
+    expectResult("divw", wordMin, static_cast<RegValue>(-1), wordMin);
+    expectResult("divw", 0x80000000, 0xffffffff, wordMin);
+    expectResult("remw", wordMin, static_cast<RegValue>(-1), 0);
+    expectResult("remw", 0x80000000, 0xffffffff, 0);
+
+    // Only the full register overflows for 64-bit division
+    expectResult("div", wordMin, static_cast<RegValue>(-1), static_cast<RegValue>(INT32_MAX) + 1);
+}
+
+TEST_F(MulDivTest, MulHighSigns) {
+    const auto minusOne = static_cast<RegValue>(-1);
+    const auto min = static_cast<RegValue>(INT64_MIN);
+
+    expectResult("mulh", minusOne, minusOne, 0);
+    expectResult("mulh", minusOne, 2, minusOne);
+    expectResult("mulh", min, min, 0x4000000000000000);
+    expectResult("mulh", min, 2, minusOne);
+
+    // rs1 is signed, rs2 is unsigned
+    expectResult("mulhsu", minusOne, minusOne, minusOne);
+    expectResult("mulhsu", 2, minusOne, 1);
+    expectResult("mulhsu", min, minusOne, min);
+    expectResult("mulhsu", minusOne, 1, minusOne);
+
+    expectResult("mulhu", minusOne, minusOne, 0xfffffffffffffffe);
+    expectResult("mulhu", min, 2, 1);
+    expectResult("mulhu", minusOne, 1, 0);
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "simulator/DecodedInstruction.h"
+#include "simulator/Decoder.h"
+
+using namespace RISCV;
+
+// Instructions compilers emit most, register fields and parts of immediates in the same bits are randomized
+static constexpr EncodedInstruction COMMON_INSTRUCTIONS[] = {
+    0x00150513,  // addi    a0, a0, 1
+    0x00058513,  // mv      a0, a1
+    0x00500513,  // li      a0, 5
+    0x0015051b,  // addiw   a0, a0, 1
+    0x0ff57513,  // andi    a0, a0, 255
+    0x00351513,  // slli    a0, a0, 3
+    0x40355513,  // srai    a0, a0, 3
+    0x00b50533,  // add     a0, a0, a1
+    0x40b50533,  // sub     a0, a0, a1
+    0x00b53533,  // sltu    a0, a0, a1
+    0x00b5053b,  // addw    a0, a0, a1
+    0x02b50533,  // mul     a0, a0, a1
+    0x02b55533,  // divu    a0, a0, a1
+    0x12345537,  // lui     a0, 0x12345
+    0x00001517,  // auipc   a0, 0x1
+    0x00813503,  // ld      a0, 8(sp)
+    0x00812503,  // lw      a0, 8(sp)
+    0x00814503,  // lbu     a0, 8(sp)
+    0x00a13423,  // sd      a0, 8(sp)
+    0x00a12423,  // sw      a0, 8(sp)
+    0x00b50863,  // beq     a0, a1, 16
+    0x00b51863,  // bne     a0, a1, 16
+    0x00b54863,  // blt     a0, a1, 16
+    0x100000ef,  // jal     ra, 256
+    0x00008067,  // ret
+};
+
+// rd, rs1 and rs2 fields
+static constexpr EncodedInstruction RANDOMIZED_BITS = 0x01ff8f80;
+static constexpr size_t CORPUS_SIZE = 1 << 16;
+static constexpr size_t ROUNDS = 200;
+
+static std::vector<EncodedInstruction> makeCorpus() {
+    constexpr size_t instrCount = sizeof(COMMON_INSTRUCTIONS) / sizeof(COMMON_INSTRUCTIONS[0]);
+    std::mt19937 rng(CORPUS_SIZE);
+    std::vector<EncodedInstruction> corpus(CORPUS_SIZE);
+    for (auto &encInstr : corpus) {
+        encInstr = COMMON_INSTRUCTIONS[rng() % instrCount] | (rng() & RANDOMIZED_BITS);
+    }
+    return corpus;
+}
+
+// Returns nanoseconds per instruction
+template <typename Decode>
+static double measure(const std::vector<EncodedInstruction> &corpus, Decode decode) {
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (EncodedInstruction encInstr : corpus) {
+            const DecodedInstruction decInstr = decode(encInstr);
+            checksum += decInstr.type + decInstr.imm;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Keeps decoding from being thrown away
+    volatile uint64_t sink = checksum;
+    static_cast<void>(sink);
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+           (ROUNDS * corpus.size());
+}
+
+int main() {
+    const Decoder decoder;
+    const auto corpus = makeCorpus();
+
+    const double table = measure(corpus, [&decoder](EncodedInstruction encInstr) {
+        return decoder.decodeInstruction(encInstr);
+    });
+    const double tree = measure(corpus, [&decoder](EncodedInstruction encInstr) {
+        return decoder.decodeInstructionByTree(encInstr);
+    });
+
+    std::cout << "Decoded instructions:        " << ROUNDS * corpus.size() << std::endl;
+    std::cout << "Table decoder, ns per instr: " << table << std::endl;
+    std::cout << "Tree decoder, ns per instr:  " << tree << std::endl;
+    return EXIT_SUCCESS;
+}
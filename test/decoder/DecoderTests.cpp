@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "simulator/DecodedInstruction.h"
+#include "simulator/Decoder.h"
+
+using namespace RISCV;
+
+static constexpr uint32_t OPCODE_MASK = 0x7f;
+static constexpr uint32_t FUNCT3_SHIFT = 12;
+static constexpr uint32_t FUNCT7_SHIFT = 25;
+
+// Register fields the specializations look at: zero, ra and ordinary registers. rs2 is also the low part of
+// immediates and shift amounts
+static constexpr uint32_t REGISTERS[] = {0, 1, 2, 10, 31};
+
+class DecoderTest : public testing::Test {
+public:
+    static EncodedInstruction encode(uint32_t opcode, uint32_t funct3, uint32_t funct7, uint32_t rd, uint32_t rs1,
+                                     uint32_t rs2) {
+        return (funct7 << FUNCT7_SHIFT) | (rs2 << 20) | (rs1 << 15) | (funct3 << FUNCT3_SHIFT) | (rd << 7) | opcode;
+    }
+
+    // Calls f for every opcode, funct3 and funct7, valid or not, with register fields from REGISTERS
+    template <typename F>
+    static void forEachEncoding(F f) {
+        for (uint32_t opcode = 0; opcode <= OPCODE_MASK; ++opcode) {
+            for (uint32_t funct3 = 0; funct3 < 8; ++funct3) {
+                for (uint32_t funct7 = 0; funct7 < 128; ++funct7) {
+                    for (uint32_t rd : REGISTERS) {
+                        for (uint32_t rs1 : REGISTERS) {
+                            for (uint32_t rs2 : REGISTERS) {
+                                f(encode(opcode, funct3, funct7, rd, rs1, rs2));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    Decoder decoder_;
+};
+
+TEST_F(DecoderTest, TableAgreesWithTree) {
+    size_t validCount = 0;
+    size_t mismatchCount = 0;
+    forEachEncoding([&](EncodedInstruction encInstr) {
+        const DecodedInstruction expected = decoder_.decodeInstructionByTree(encInstr);
+        const DecodedInstruction actual = decoder_.tryDecodeInstruction(encInstr);
+        if (actual.type != expected.type) {
+            ADD_FAILURE() << "type of 0x" << std::hex << encInstr;
+            ++mismatchCount;
+            return;
+        }
+        if (expected.type == InstructionType::INSTRUCTION_INVALID) {
+            return;
+        }
+
+        ++validCount;
+        const DecodedInstruction asserted = decoder_.decodeInstruction(encInstr);
+        if (actual.rd != expected.rd || actual.rs1 != expected.rs1 || actual.rs2 != expected.rs2 ||
+            actual.imm != expected.imm || asserted.type != expected.type || asserted.imm != expected.imm) {
+            ADD_FAILURE() << "fields of 0x" << std::hex << encInstr;
+            ++mismatchCount;
+        }
+    });
+    EXPECT_EQ(mismatchCount, 0U);
+
+    // Sweep is not vacuous, each instruction type gets several register fields on average
+    EXPECT_GT(validCount, static_cast<size_t>(InstructionType::INSTRUCTION_COUNT));
+}
+
+TEST_F(DecoderTest, UnknownEncodingIsInvalid) {
+    // Compressed instructions and OP with funct7 of neither base nor M extension
+    for (EncodedInstruction encInstr : {0x00000001U, 0x00000000U, encode(0b0110011, 0b000, 0b0000010, 10, 10, 11)}) {
+        EXPECT_EQ(decoder_.tryDecodeInstruction(encInstr).type, InstructionType::INSTRUCTION_INVALID)
+            << std::hex << encInstr;
+        EXPECT_EQ(decoder_.decodeInstructionByTree(encInstr).type, InstructionType::INSTRUCTION_INVALID)
+            << std::hex << encInstr;
+    }
+}
+
+TEST_F(DecoderTest, ShiftAmountUsesFunct7LowBit) {
+    // SRAI and SRLI differ by funct7, bit 25 is the upper bit of 6-bit shift amount
+    const DecodedInstruction srai = decoder_.decodeInstruction(encode(0b0010011, 0b101, 0b0100001, 10, 11, 3));
+    EXPECT_EQ(srai.type, InstructionType::SRAI);
+    EXPECT_EQ(srai.imm, 35);
+    const DecodedInstruction srli = decoder_.decodeInstruction(encode(0b0010011, 0b101, 0b0000001, 10, 11, 3));
+    EXPECT_EQ(srli.type, InstructionType::SRLI);
+    EXPECT_EQ(srli.imm, 35);
+
+    // Word shifts take 5-bit amount only
+    EXPECT_EQ(decoder_.tryDecodeInstruction(encode(0b0011011, 0b101, 0b0000001, 10, 11, 3)).type,
+              InstructionType::INSTRUCTION_INVALID);
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "simulator/BasicBlock.h"
+#include "simulator/Decoder.h"
+#include "simulator/Dispatcher.h"
+#include "simulator/Hart.h"
+#include "simulator/memory/Memory.h"
+#include "test/common/Encoding.h"
+
+using namespace RISCV;
+using namespace RISCV::encoding;
+
+class BasicBlockTest : public testing::Test {
+public:
+    static constexpr BasicBlock::Entrypoint ENTRYPOINT = 0x10000;
+
+    BasicBlock::Body decode(std::initializer_list<EncodedInstruction> encodings) const {
+        BasicBlock::Body body;
+        for (EncodedInstruction encoding : encodings) {
+            body.push_back(decoder_.decodeInstruction(encoding));
+        }
+        return body;
+    }
+
+    // NOP may start a superinstruction, ADDI + LD for instance
+    static bool isNop(const DecodedInstruction &instr) {
+        return getOriginalInstruction(instr.type) == InstructionType::ADDI && instr.rd == RegisterType::ZERO &&
+               instr.rs1 == RegisterType::ZERO && instr.imm == 0;
+    }
+
+    // Compiler sees original types of specialized instructions and superinstructions
+    static void expectSameInstr(const DecodedInstruction &actual, const DecodedInstruction &expected, size_t offset) {
+        EXPECT_EQ(actual.type, getOriginalInstruction(expected.type)) << offset;
+        EXPECT_EQ(actual.rd, expected.rd) << offset;
+        EXPECT_EQ(actual.rs1, expected.rs1) << offset;
+        EXPECT_EQ(actual.rs2, expected.rs2) << offset;
+        EXPECT_EQ(actual.imm, expected.imm) << offset;
+    }
+
+protected:
+    Decoder decoder_;
+};
+
+TEST_F(BasicBlockTest, NopBeforeInstructionObservingPCIsKept) {
+    // PC is read by AUIPC and calls, ECALL may stop the program and memory access may fault at the current PC
+    for (EncodedInstruction observer : {auipc(RegisterType::A0, 1), jal(RegisterType::RA, 16),
+                                        jalr(RegisterType::RA, RegisterType::A1, 0), ecall(),
+                                        ld(RegisterType::A0, RegisterType::A1, 8),
+                                        sd(RegisterType::A0, RegisterType::A1, 8)}) {
+        auto body = decode({nop(), addi(RegisterType::A2, RegisterType::A2, 1), observer});
+        const auto droppedNops = BasicBlock::prepareBody(body);
+        EXPECT_EQ(droppedNops, 0) << observer;
+        ASSERT_EQ(body.size(), 4U) << observer;
+        EXPECT_TRUE(isNop(body[0])) << observer;
+        EXPECT_EQ(body.back().type, BASIC_BLOCK_END) << observer;
+        EXPECT_EQ(body.back().imm, 0) << observer;
+    }
+}
+
+TEST_F(BasicBlockTest, NopAfterLastMemoryAccessIsDropped) {
+    auto body = decode({nop(), ld(RegisterType::A0, RegisterType::A1, 8), nop(),
+                        addi(RegisterType::A0, RegisterType::A0, 1), beq(RegisterType::A0, RegisterType::A2, -12)});
+    const auto droppedNops = BasicBlock::prepareBody(body);
+    EXPECT_EQ(droppedNops, 0b00100);
+    ASSERT_EQ(body.size(), 5U);
+    EXPECT_TRUE(isNop(body[0]));
+    EXPECT_EQ(body.back().imm, INSTRUCTION_BYTESIZE);
+}
+
+TEST_F(BasicBlockTest, BasicBlockEndCoversDroppedNops) {
+    auto body =
+        decode({nop(), addi(RegisterType::A0, RegisterType::A0, 1), nop(), nop(), jal(RegisterType::ZERO, -16)});
+    const auto droppedNops = BasicBlock::prepareBody(body);
+    EXPECT_EQ(droppedNops, 0b01101);
+    ASSERT_EQ(body.size(), 3U);
+    EXPECT_EQ(body.back().type, BASIC_BLOCK_END);
+    EXPECT_EQ(body.back().imm, 3 * INSTRUCTION_BYTESIZE);
+
+    // Block which ends at size limit keeps its last NOP, PC lag would outlive the block otherwise
+    body = decode({addi(RegisterType::A0, RegisterType::A0, 1), nop()});
+    EXPECT_EQ(BasicBlock::prepareBody(body), 0);
+    ASSERT_EQ(body.size(), 3U);
+    EXPECT_EQ(body.back().imm, 0);
+}
+
+TEST_F(BasicBlockTest, GetBodyGivesBackFetchedInstructions) {
+    // Specialized store, LI and MV, dropped NOPs and LUI + ADDI superinstruction
+    const auto fetched = decode({sd(RegisterType::ZERO, RegisterType::SP, 8), nop(),
+                                 addi(RegisterType::A0, RegisterType::ZERO, 5), nop(), lui(RegisterType::A1, 0x12345),
+                                 addi(RegisterType::A1, RegisterType::A1, 0x678),
+                                 addi(RegisterType::A2, RegisterType::A1, 0), jal(RegisterType::ZERO, -28)});
+
+    auto body = fetched;
+    const auto droppedNops = BasicBlock::prepareBody(body);
+    EXPECT_EQ(droppedNops, 0b1010);
+    BasicBlock bb(std::move(body), ENTRYPOINT, droppedNops);
+    EXPECT_EQ(bb.getInstrCount(), fetched.size());
+
+    const auto restored = bb.getBody();
+    ASSERT_EQ(restored.size(), fetched.size() + 1);
+    for (size_t i = 0; i < fetched.size(); ++i) {
+        expectSameInstr(restored[i], fetched[i], i);
+    }
+    EXPECT_EQ(restored.back().type, BASIC_BLOCK_END);
+}
+
+struct FusedPair {
+    const char *name;
+    EncodedInstruction first;
+    EncodedInstruction second;
+};
+
+// Every pair listed in superinstructions of ISA description, with operands the fused handler has to get right
+static const std::vector<FusedPair> FUSED_PAIRS = {
+    {"lui addi", lui(RegisterType::A0, 0x12345), addi(RegisterType::A0, RegisterType::A0, -1)},
+    {"lui addiw", lui(RegisterType::A0, 0x80000), addiw(RegisterType::A0, RegisterType::A0, -1)},
+    {"auipc addi", auipc(RegisterType::A0, 1), addi(RegisterType::A0, RegisterType::A0, 16)},
+    {"auipc jalr", auipc(RegisterType::T1, 0), jalr(RegisterType::RA, RegisterType::T1, 32)},
+    {"slt bne", slt(RegisterType::T0, RegisterType::A1, RegisterType::A2),
+     bne(RegisterType::T0, RegisterType::ZERO, 16)},
+    {"sltu bne", sltu(RegisterType::T0, RegisterType::A1, RegisterType::A2),
+     bne(RegisterType::T0, RegisterType::ZERO, 16)},
+    {"slti bne", slti(RegisterType::T0, RegisterType::A1, 5), bne(RegisterType::T0, RegisterType::ZERO, 16)},
+    {"sltiu bne", sltiu(RegisterType::T0, RegisterType::A1, 5), bne(RegisterType::T0, RegisterType::ZERO, 16)},
+    {"addi sd", addi(RegisterType::SP, RegisterType::SP, -16), sd(RegisterType::A1, RegisterType::SP, 8)},
+    {"addi ld", addi(RegisterType::A0, RegisterType::SP, 8), ld(RegisterType::A3, RegisterType::A0, 0)},
+    {"ld addi", ld(RegisterType::A3, RegisterType::SP, 0), addi(RegisterType::A3, RegisterType::A3, 1)},
+};
+
+// Operands of comparisons: less, equal, greater, signed and unsigned order disagree
+static const std::vector<std::pair<RegValue, RegValue>> OPERANDS = {
+    {1, 2}, {5, 5}, {7, 3}, {static_cast<RegValue>(-1), 1}, {1, static_cast<RegValue>(-1)},
+};
+
+class SuperinstructionTest : public BasicBlockTest {
+public:
+    static constexpr memory::VirtAddr DATA_ADDR = 0x20000;
+    static constexpr memory::VirtAddr STACK_ADDR = DATA_ADDR + memory::PAGE_BYTESIZE / 2;
+    static constexpr size_t DATA_SIZE = 64;
+
+    struct State {
+        std::array<RegValue, RegisterType::REGISTER_COUNT> regs;
+        memory::VirtAddr pc;
+        std::array<uint8_t, DATA_SIZE> data;
+    };
+
+    void SetUp() override {
+        hart_ = std::make_unique<Hart>();
+        dispatcher_ = std::make_unique<Dispatcher>(hart_.get());
+        const memory::PhysAddr paddr = hart_->getTranslator().getPhysAddrWithAllocation(DATA_ADDR);
+        ASSERT_TRUE(memory::getPhysicalMemory().allocatePage(memory::getPageNumber(paddr)));
+    }
+
+    void TearDown() override {
+        dispatcher_.reset();
+        hart_.reset();
+        memory::getPhysicalMemory().freeAllPages();
+    }
+
+    // Interprets body from the same state every time: registers hold their numbers, operands are given and stack
+    // holds known bytes
+    State run(BasicBlock::Body body, std::pair<RegValue, RegValue> operands) {
+        for (uint32_t reg = 1; reg < RegisterType::REGISTER_COUNT; ++reg) {
+            hart_->setReg(static_cast<RegisterType>(reg), reg);
+        }
+        hart_->setReg(RegisterType::SP, STACK_ADDR);
+        hart_->setReg(RegisterType::A1, operands.first);
+        hart_->setReg(RegisterType::A2, operands.second);
+        hart_->setPC(ENTRYPOINT);
+
+        std::array<uint8_t, DATA_SIZE> data;
+        for (size_t i = 0; i < DATA_SIZE; ++i) {
+            data[i] = i;
+        }
+        memory::getPhysicalMemory().write(getStackPhysAddr(), DATA_SIZE, data.data());
+
+#if defined(RISCV_DIRECT_THREADED)
+        for (auto &instr : body) {
+            instr.handler = dispatcher_->getHandler(instr.type);
+        }
+#endif
+        dispatcher_->dispatchExecute(body.data());
+
+        State state;
+        for (uint32_t reg = 0; reg < RegisterType::REGISTER_COUNT; ++reg) {
+            state.regs[reg] = hart_->getReg(static_cast<RegisterType>(reg));
+        }
+        state.pc = hart_->getPC();
+        memory::getPhysicalMemory().read(getStackPhysAddr(), DATA_SIZE, state.data.data());
+        return state;
+    }
+
+    // Stores of the pairs land within DATA_SIZE / 2 bytes around stack pointer
+    memory::PhysAddr getStackPhysAddr() {
+        return hart_->getTranslator().getPhysAddr<memory::MemoryType::RMem>(STACK_ADDR - DATA_SIZE / 2);
+    }
+
+protected:
+    std::unique_ptr<Hart> hart_;
+    std::unique_ptr<Dispatcher> dispatcher_;
+};
+
+TEST_F(SuperinstructionTest, FusedBodyRunsAsUnfused) {
+    for (const auto &pair : FUSED_PAIRS) {
+        auto unfused = decode({pair.first, pair.second});
+        unfused.emplace_back(DecodedInstruction{.type = BASIC_BLOCK_END});
+
+        auto fused = decode({pair.first, pair.second});
+        EXPECT_EQ(BasicBlock::prepareBody(fused), 0) << pair.name;
+        ASSERT_EQ(fused.size(), unfused.size()) << pair.name;
+        ASSERT_NE(fused[0].type, unfused[0].type) << pair.name;
+
+        for (const auto &operands : OPERANDS) {
+            const State expected = run(unfused, operands);
+            const State actual = run(fused, operands);
+            EXPECT_EQ(actual.regs, expected.regs) << pair.name << " " << operands.first << ", " << operands.second;
+            EXPECT_EQ(actual.pc, expected.pc) << pair.name << " " << operands.first << ", " << operands.second;
+            EXPECT_EQ(actual.data, expected.data) << pair.name << " " << operands.first << ", " << operands.second;
+        }
+    }
+}
+
+TEST_F(BasicBlockTest, GetBodySplitsSuperinstructions) {
+    for (const auto &pair : FUSED_PAIRS) {
+        const auto fetched = decode({pair.first, pair.second});
+        auto body = fetched;
+        BasicBlock::prepareBody(body);
+        EXPECT_EQ(getOriginalInstruction(body[0].type), getOriginalInstruction(fetched[0].type)) << pair.name;
+
+        BasicBlock bb(std::move(body), ENTRYPOINT);
+        const auto restored = bb.getBody();
+        ASSERT_EQ(restored.size(), fetched.size() + 1) << pair.name;
+        for (size_t i = 0; i < fetched.size(); ++i) {
+            expectSameInstr(restored[i], fetched[i], i);
+        }
+    }
+}